@@ -1,8 +1,50 @@
 #include <SDL.h>
 #include <vector>
 #include <cmath>
-#include <map>
+#include <string>
 #include <algorithm>
+#include <tuple>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <cstdio>
+#include <new>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+// Memory-mapped level files on POSIX targets (everything else reads into one buffer)
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define UPHILL_MMAP
+#endif
+
+// Worker threads for batch jobs (web builds only get them with -pthread)
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#define UPHILL_THREADS
+#endif
+
+// 4-wide float SIMD for the batched physics path (scalar fallback otherwise)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UPHILL_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define UPHILL_SIMD_NEON
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define UPHILL_SIMD_WASM
+#endif
 
 // ==========================================
 // CONFIGURATION & CONSTANTS
@@ -19,26 +61,352 @@ const float ACCELERATION = 3000.0f;
 const float FRICTION = 2500.0f;
 const float AIR_FRICTION = 500.0f;
 const float MAX_FALL_SPEED = 1000.0f;
-const float TIME_STEP = 0.016f;
+const float JUMP_BUFFER_TIME = 0.1f; // s a press stays buffered before landing
+const float COYOTE_TIME = 0.08f;     // s the player can still jump after leaving an edge
+const int PHYSICS_HZ = 60;
+const float TIME_STEP = 1.0f / PHYSICS_HZ;
+// Jump windows in whole steps, so they keep their length at any physics rate
+const int JUMP_BUFFER_STEPS = (int)(JUMP_BUFFER_TIME * PHYSICS_HZ + 0.5f);
+const int COYOTE_STEPS = (int)(COYOTE_TIME * PHYSICS_HZ + 0.5f);
+const int MAX_STEPS_PER_FRAME = 8; // Spiral-of-death guard; extra backlog is dropped
+const float CONTACT_SKIN = 0.1f; // px; a surface this far behind still blocks (float rounding)
+const Uint8 PHYSICS_EVENT_JUMP = 1;    // UpdatePhysics result bits
+const Uint8 PHYSICS_EVENT_RESPAWN = 2; // Fell out of the level
+
+// Replays
+const Uint32 REPLAY_MAGIC = 0x50525055; // "UPRP" little-endian
+const Uint8 REPLAY_VERSION = 6; // Bumped whenever the simulation changes too
+const size_t REPLAY_RESERVE_BYTES = 64 * 1024; // Hours of typical play before the buffer grows
+
+// Level Files
+const Uint32 LEVEL_MAGIC = 0x564C5055; // "UPLV" little-endian
+const Uint32 LEVEL_VERSION = 2;
+const int LEVEL_CHUNK_HEIGHT = 720; // Streaming unit: one screen of climb
+
+// Level Streaming
+const int STREAM_PREFETCH_MARGIN = LEVEL_CHUNK_HEIGHT;  // Load chunks this far beyond the view
+const int STREAM_EVICT_MARGIN = 3 * LEVEL_CHUNK_HEIGHT; // Drop chunks this far beyond the view
+const int OBSTACLE_FREE = -1; // Obstacle::type of an unused World slot
+const float INTERPOLATION_SNAP_DISTANCE = 128.0f; // Larger jumps per step are teleports
+
+// Broadphase
+const int GRID_CELL_SIZE = 128; // Edge length of one spatial grid cell (px)
+
+// Obstacle Types (Obstacle::type; everything but SOLID moves or vanishes each step)
+const int OBSTACLE_SOLID = 0;
+const int OBSTACLE_MOVING = 1;    // Slides sideways and back
+const int OBSTACLE_CRUMBLING = 2; // Falls away for a while, then grows back
+const int OBSTACLE_ELEVATOR = 3;  // Rises and sinks, pausing at both ends
+const int MOVING_TRAVEL = 192;          // px
+const float MOVING_TRAVEL_TIME = 2.0f;  // s from one end to the other
+const int ELEVATOR_TRAVEL = 320;        // px
+const float ELEVATOR_TRAVEL_TIME = 3.0f;
+const float ELEVATOR_WAIT_TIME = 1.0f;
+const float CRUMBLE_SOLID_TIME = 3.0f;
+const float CRUMBLE_GONE_TIME = 1.5f;
+const int MOVING_TRAVEL_STEPS = (int)(MOVING_TRAVEL_TIME * PHYSICS_HZ + 0.5f);
+const int ELEVATOR_TRAVEL_STEPS = (int)(ELEVATOR_TRAVEL_TIME * PHYSICS_HZ + 0.5f);
+const int ELEVATOR_WAIT_STEPS = (int)(ELEVATOR_WAIT_TIME * PHYSICS_HZ + 0.5f);
+const int CRUMBLE_SOLID_STEPS = (int)(CRUMBLE_SOLID_TIME * PHYSICS_HZ + 0.5f);
+const int CRUMBLE_GONE_STEPS = (int)(CRUMBLE_GONE_TIME * PHYSICS_HZ + 0.5f);
+const int MAX_CARRY_STEP = 16; // px; a bigger jump of the ground means its slot was reused
+
+// Rendering
+const bool BAKE_STATIC_LAYER = true; // Pre-render level geometry into one texture
+const int STATIC_LAYER_MAX_PIXELS = 4096 * 4096; // Bigger levels draw culled batches instead
+const float CAMERA_FOCUS_Y = 0.6f; // Player sits slightly below center (more view uphill)
+
+// Frame Profiler
+// On in debug builds (or with -DUPHILL_PROFILE); release builds (-DNDEBUG)
+// compile every PROFILE_* macro to nothing.
+#if !defined(NDEBUG) && !defined(UPHILL_PROFILE)
+#define UPHILL_PROFILE
+#endif
+const int PROFILE_FRAME_HISTORY = 240;   // Frames kept for the overlay (4 s at 60 fps)
+const int PROFILE_EVENT_CAPACITY = 8192; // Timed scopes kept for the trace dump
+const char* const PROFILE_TRACE_FILE = "uphill_trace.json"; // F4 writes it here
+
+// Debug builds count heap allocations on the main thread and log frames
+// that still allocate after warm-up (the frame loop should be allocation-free).
+#ifndef NDEBUG
+#define UPHILL_COUNT_ALLOCATIONS
+#endif
+const Uint64 ALLOCATION_WARMUP_FRAMES = 120; // Scratch buffers reach steady size by then
+const int ALLOCATION_REPORT_LIMIT = 20;      // Log lines before going quiet
+
+// Touch Input
+const int MAX_TOUCHES = 10; // Fingers tracked at once; extra fingers are ignored
+
+// Rollback (head-to-head races)
+const int RACE_PLAYERS = 2;
+const int ROLLBACK_MAX_STEPS = 8; // Furthest we run ahead of the remote player's inputs (and re-simulate)
+const int ROLLBACK_RING = 16;     // Saved frames; must exceed ROLLBACK_MAX_STEPS
+const Uint32 ROLLBACK_NONE = 0xFFFFFFFFu;
+
+// Low-Latency Mode (--low-latency)
+const int INPUT_QUEUE_CAPACITY = 64; // Input events waiting for their physics step
+
+// Particles (cosmetic: updated per frame, never read by physics)
+const int PARTICLE_CAPACITY = 65536;   // Fixed pool; emitters drop particles once it's full
+const float PARTICLE_GRAVITY = 900.0f; // px/s^2, scaled by each particle's weight
+const float PARTICLE_MAX_FRAME_TIME = 0.1f; // s; longer frames (breakpoints) don't fling particles
+const int LANDING_DUST_MAX = 24;       // Particles for a landing at MAX_FALL_SPEED
+const int JUMP_TRAIL_PER_FRAME = 2;    // While rising after a jump
+const float WEATHER_RATE = 300.0f;     // Snowflakes per second across the view
+
+// Adaptive Quality
+// Steps down quickly when frames run over budget and back up slowly once
+// there is clear headroom, so it doesn't flip-flop around the threshold.
+const float QUALITY_SLOW_FACTOR = 1.15f; // Frame interval over budget * this counts as slow
+const float QUALITY_FAST_FACTOR = 0.6f;  // CPU work under budget * this counts as headroom
+const int QUALITY_DOWN_FRAMES = 30;      // Slow frames in a row before stepping down (0.5 s)
+const int QUALITY_UP_FRAMES = 240;       // Fast frames in a row before stepping up (4 s)
+const float QUALITY_SMOOTHING = 0.1f;    // Weight of the newest frame in the averages
+const float QUALITY_OUTLIER_MS = 250.0f; // Longer frames (loading, suspend) are ignored
+
+// Power Saving
+// A frame that would look exactly like the one on screen isn't drawn, and
+// the native loop sleeps until input instead of spinning on vsync.
+const float IDLE_WEATHER_TIMEOUT = 10.0f; // s at rest before the snow stops, so the screen can go still
+const Uint32 IDLE_WAKE_MS = 1000;         // Longest sleep; a safety net for changes that send no event
+
+// Level Validation
+// Standing states are deduplicated on a coarse grid, so the search stays
+// at a few hundred states per screen rather than millions.
+const int VALIDATE_CELL = 16;             // px; standing spots closer than this count as one
+const int VALIDATE_DYNAMIC_RADIUS = 192;  // px; near a dynamic obstacle, when the player arrives matters
+const Uint32 VALIDATE_PHASE_STEPS = PHYSICS_HZ / 4; // Arrival times closer than this count as one
+const Uint32 VALIDATE_PHASES = 36;        // ... repeating every 9 s (two crumble cycles, over two moving ones)
+const int VALIDATE_MAX_MANEUVER_STEPS = 3 * PHYSICS_HZ; // A jump or fall still airborne after this is dropped
+const int VALIDATE_POSE_MARGIN = 64;      // px around the player within which dynamic obstacles are posed
+const int VALIDATE_SET_BITS = 23;         // Seen-state set of 8M slots (64 MB)
+const size_t VALIDATE_JOB_GRAIN = 16;     // Maneuvers per job (a climb's waves are only tens of nodes wide)
+const int VALIDATE_REPORT_LIMIT = 20;     // Platforms not reached, listed by rect
+
+// Telemetry
+// Session metrics are counted in place and written in batches by a
+// background thread, so a frame only pays for a few atomic adds.
+const Uint32 TELEMETRY_MAGIC = 0x4C545055; // "UPTL" little-endian
+const Uint8 TELEMETRY_VERSION = 1;
+const float TELEMETRY_BUCKET_MS = 0.5f;  // Frame time histogram resolution
+const int TELEMETRY_TIME_BUCKETS = 100;  // 0-50 ms; the last bucket also counts everything longer
+const Uint32 TELEMETRY_FLUSH_MS = 10000; // One batch every 10 s
+
+// Benchmark Suite
+const int BENCH_SIZES[] = { 10, 100, 1000, 10000, 100000, 1000000 }; // Obstacles per synthetic level
+const int BENCH_PLAYERS = 64;         // Bots simulated per level
+const int BENCH_STEPS = 600;          // Steps per bot (10 s of play)
+const int BENCH_RENDER_FRAMES = 60;   // Frames submitted to the software renderer
+const int BENCH_PARTICLES = 50000;    // Live particles for the particle update/submit timing
+const int BENCH_SPACING = 200;        // Average px between obstacles (keeps density constant)
+const char* const BENCH_LEVEL_FILE = "uphill_bench.lvl"; // Scratch file for the load timing
+
+// Tile Atlas
+// One block of 3x3 tiles (corners, edges, center) per obstacle type, then
+// one block for the player. Generated from OBSTACLE_STYLES unless
+// TILE_ATLAS_FILE exists with the same layout.
+const int TILE_SIZE = 32;
+const int TILE_BLOCK_SIZE = 3 * TILE_SIZE;
+const int TILE_BORDER = 3; // Border width in the generated atlas (px)
+const char* const TILE_ATLAS_FILE = "tiles.bmp";
 
 // ==========================================
 // STRUCTS
 // ==========================================
 
-struct Vec2 { float x, y; };
+// Q16.16 fixed point: integer-only math, so x86, ARM and WASM produce
+// identical results. Covers +-32767 px, about 45 screens of climb.
+struct Fixed {
+    Sint32 raw;
+    constexpr Fixed() : raw(0) {}
+    constexpr Fixed(int v) : raw((Sint32)((Uint32)v << 16)) {} // Unsigned shift: out of range wraps instead of UB
+    constexpr Fixed(float v) : raw((Sint32)(v * 65536.0f + (v < 0 ? -0.5f : 0.5f))) {}
+};
+
+inline Fixed FixedFromRaw(Sint32 raw) { Fixed f; f.raw = raw; return f; }
+inline Fixed operator+(Fixed a, Fixed b) { return FixedFromRaw(a.raw + b.raw); }
+inline Fixed operator-(Fixed a, Fixed b) { return FixedFromRaw(a.raw - b.raw); }
+inline Fixed operator-(Fixed a) { return FixedFromRaw(-a.raw); }
+inline Fixed operator*(Fixed a, Fixed b) { return FixedFromRaw((Sint32)(((Sint64)a.raw * b.raw) >> 16)); }
+inline Fixed operator/(Fixed a, Fixed b) { return FixedFromRaw((Sint32)(((Sint64)a.raw * 65536) / b.raw)); }
+inline Fixed& operator+=(Fixed& a, Fixed b) { return a = a + b; }
+inline Fixed& operator-=(Fixed& a, Fixed b) { return a = a - b; }
+inline Fixed& operator*=(Fixed& a, Fixed b) { return a = a * b; }
+inline bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+inline bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+inline bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+inline bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+inline bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+inline bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
 
-struct Player {
-    Vec2 pos;
-    Vec2 vel;
-    Vec2 size;
+inline float ToFloat(float v) { return v; }
+inline float ToFloat(Fixed v) { return v.raw / 65536.0f; }
+inline int FloorToInt(float v) { return (int)std::floor(v); }
+inline int FloorToInt(Fixed v) { return v.raw >> 16; }
+inline int CeilToInt(float v) { return (int)std::ceil(v); }
+inline int CeilToInt(Fixed v) { return (int)(((Sint64)v.raw + 0xFFFF) >> 16); }
+
+// Number type of the simulation (-DUPHILL_FIXED_POINT for bit-exact physics)
+#ifdef UPHILL_FIXED_POINT
+typedef Fixed Scalar;
+const Uint8 PHYSICS_NUMERIC = 1; // Recorded in replays; float and fixed runs don't mix
+#else
+typedef float Scalar;
+const Uint8 PHYSICS_NUMERIC = 0;
+#endif
+
+template <typename S>
+struct Vec2T { S x, y; };
+typedef Vec2T<float> Vec2;
+typedef Vec2T<Scalar> SimVec2;
+
+template <typename S>
+struct PlayerT {
+    Vec2T<S> pos;
+    Vec2T<S> vel;
+    Vec2T<S> size;
     bool onGround;
+    int jumpBuffer; // Steps a jump press stays buffered (0 = none)
+    int coyote;     // Steps left to jump after walking off an edge
+    int ground;         // Obstacle stood on (-1 = none); moving ones carry the player
+    SDL_Point groundAt; // Where that obstacle was when the player last touched it
 };
+typedef PlayerT<Scalar> Player;
 
 struct Obstacle {
     SDL_Rect rect;
     int type;
 };
 
+// Scrolling view into the world. The view is always SCREEN_WIDTH x SCREEN_HEIGHT
+// logical pixels; 'bounds' is the world area it may show.
+struct Camera {
+    float x, y; // Top-left corner in world space
+    SDL_Rect bounds;
+};
+
+// An obstacle whose rect changes with time (see the OBSTACLE_* types)
+struct DynamicObstacle {
+    int index;         // Into World::obstacles
+    SDL_Rect home;     // Rect from the level data; poses are offsets from it
+    SDL_Rect previous; // Rect one step ago (for interpolated drawing)
+    bool solid;        // In the grid; false while crumbled away
+};
+
+// Obstacle colors, indexed by Obstacle::type
+struct ObstacleStyle {
+    SDL_Color fill;
+    SDL_Color border;
+};
+
+const ObstacleStyle OBSTACLE_STYLES[] = {
+    { {34, 139, 34, 255}, {0, 100, 0, 255} },    // 0: Solid (Forest Green)
+    { {70, 130, 180, 255}, {25, 25, 112, 255} },  // 1: Moving (Steel Blue)
+    { {222, 184, 135, 255}, {139, 90, 43, 255} }, // 2: Crumbling (Burlywood)
+    { {112, 128, 144, 255}, {47, 79, 79, 255} },  // 3: Elevator (Slate Gray)
+};
+const int OBSTACLE_STYLE_COUNT = sizeof(OBSTACLE_STYLES) / sizeof(OBSTACLE_STYLES[0]);
+const ObstacleStyle PLAYER_STYLE = { {255, 69, 0, 255}, {178, 34, 0, 255} }; // Red-Orange
+
+// Textured quads for one SDL_RenderGeometry call
+struct TileBatch {
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+// Uniform Grid Broadphase
+// Every cell keeps a singly linked list of obstacle indices. All nodes live in
+// one pool (with a free list), so patching the grid doesn't allocate once warm.
+struct SpatialGrid {
+    int originX = 0, originY = 0; // World position of cell (0,0)
+    int cols = 0, rows = 0;
+    std::vector<int> cellHead;     // First node of each cell (-1 = empty)
+    std::vector<int> nodeObstacle; // Obstacle index stored in each node
+    std::vector<int> nodeNext;     // Next node in the same cell (-1 = end)
+    int freeNode = -1;             // Head of the recycled node list
+};
+
+// Everything physics collides against. Passed explicitly so a simulation
+// step has no hidden global state (headless runs, batches, rollback).
+struct World {
+    Uint32 levelId = 0; // Identifies the level in replays
+    std::vector<Obstacle> obstacles;
+    SpatialGrid grid;
+    SDL_Rect cameraBounds = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    std::vector<int> freeSlots; // Indices of OBSTACLE_FREE entries, reused first
+    bool streaming = false;     // Only the chunks around the camera are resident
+    std::vector<DynamicObstacle> dynamics; // Obstacles that move; only these are updated per step
+
+    // The obstacles as authored, kept for drawing and saving once
+    // MergeCollisionRects has turned 'obstacles' into fewer, larger colliders.
+    // Empty when nothing merged (then 'obstacles' is both).
+    std::vector<Obstacle> visuals;
+    SpatialGrid visualGrid;
+};
+
+// Binary level file header. The file is laid out so it can be used straight
+// from a memory map: every field is 4 bytes, and the obstacle records that
+// follow are the in-memory Obstacle layout (all our targets are little-endian).
+//   header | Obstacle[obstacleCount] | LevelChunk[chunkCount] | i32 cellHead[cols * rows]
+//          | i32 nodeObstacle[gridNodeCount] | i32 nodeNext[gridNodeCount]
+// Obstacles are sorted by chunk, so each chunk is one contiguous record range.
+struct LevelFileHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 levelId;
+    Uint32 obstacleCount;
+    SDL_Rect cameraBounds;
+    Sint32 gridCellSize; // Must match GRID_CELL_SIZE, otherwise the index is rebuilt
+    Sint32 gridOriginX, gridOriginY;
+    Sint32 gridCols, gridRows;
+    Uint32 gridNodeCount;
+    Sint32 chunkHeight; // Chunk k starts at gridOriginY + k * chunkHeight
+    Uint32 chunkCount;
+};
+
+// A horizontal band of the level, for streaming
+struct LevelChunk {
+    Uint32 firstObstacle;
+    Uint32 obstacleCount;
+    Sint32 top, bottom; // Vertical extent of the chunk's obstacles (may exceed the band)
+};
+
+// Chunk streaming state. Residency is decided on the main thread; the loader
+// thread only reads records from the file and hands them back.
+enum ChunkState : Uint8 {
+    CHUNK_EVICTED,
+    CHUNK_REQUESTED,
+    CHUNK_RESIDENT,
+};
+
+struct LoadedChunk {
+    int chunk;
+    std::vector<Obstacle> obstacles;
+};
+
+struct ChunkStreamer {
+    bool open = false;
+    char path[512];
+    LevelFileHeader header;
+    std::vector<LevelChunk> chunks;
+    std::vector<Uint8> state;            // ChunkState per chunk
+    std::vector<std::vector<int>> slots; // World obstacle indices owned by each resident chunk
+
+    // Loader mailbox (guarded by 'lock' when threads are available)
+    std::deque<int> requests;
+    std::vector<LoadedChunk> completed;
+#ifdef UPHILL_THREADS
+    std::thread loader;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool quit = false;
+#endif
+};
+
+static_assert(sizeof(Obstacle) == 20, "Obstacle records are stored as 5 x i32 in level files");
+static_assert(sizeof(LevelFileHeader) == 64, "LevelFileHeader must not contain padding");
+static_assert(sizeof(LevelChunk) == 16, "LevelChunk must not contain padding");
+
 // Input Abstraction (Decouples Hardware from Logic)
 struct InputState {
     bool left = false;
@@ -47,11 +415,300 @@ struct InputState {
     bool jumpHeld = false;    // True while holding button
 };
 
+// On-screen buttons. New ones (dash, climb) only need an ID and a rect in
+// InitControls; fingers are matched to buttons on touch events, not per frame.
+enum ButtonId {
+    BUTTON_LEFT,
+    BUTTON_RIGHT,
+    BUTTON_JUMP,
+    BUTTON_COUNT,
+};
+
+// One step of the adaptive quality ladder. Physics always runs at
+// PHYSICS_HZ (replays and rollback depend on it); what drops is how many
+// steps a slow frame may catch up on, so the game slows down instead of
+// stalling further behind.
+struct QualityTier {
+    float renderScale;    // World drawn at this fraction of SCREEN_WIDTH x SCREEN_HEIGHT, then stretched
+    int particleLimit;    // Live particles allowed
+    int maxStepsPerFrame; // Catch-up steps per frame
+};
+
+const QualityTier QUALITY_TIERS[] = {
+    { 1.0f, PARTICLE_CAPACITY, MAX_STEPS_PER_FRAME }, // 0: Full
+    { 0.85f, 16384, MAX_STEPS_PER_FRAME },
+    { 0.7f, 4096, 4 },
+    { 0.5f, 1024, 2 },                                 // 3: Lowest
+};
+const int QUALITY_TIER_COUNT = sizeof(QUALITY_TIERS) / sizeof(QUALITY_TIERS[0]);
+
+// Watches frame times and moves along QUALITY_TIERS to hold the target rate
+struct QualityController {
+    bool adaptive = true; // false with --quality N
+    int tier = 0;
+    float budgetMs = 1000.0f / 60;
+    float frameMs = 0;    // Smoothed frame interval (what the player sees)
+    float workMs = 0;     // Smoothed CPU time per frame, without the vsync wait
+    int slowFrames = 0, fastFrames = 0;
+    int changes = 0;
+};
+
 // Touch Button Definition
 struct TouchButton {
     SDL_Rect rect;
-    std::string name; // For debugging
-    bool active;      // Visual feedback
+    const char* name;     // For debugging
+    int pressCount;       // Fingers currently on the button (> 0 = held)
+    Uint32 lastPressTime; // SDL event timestamp (ms) of the latest press
+};
+
+// Fixed-capacity finger table, open addressing by finger ID. Lives in the
+// struct itself so touches never allocate.
+struct TouchSlot {
+    SDL_FingerID id;
+    Vec2 pos;   // Logical coordinates
+    int button; // ButtonId the finger is on, or -1
+    bool used;
+};
+
+struct TouchTable {
+    TouchSlot slots[MAX_TOUCHES];
+};
+
+// Fixed-capacity particle pool in struct-of-arrays layout. Live particles
+// are packed into [0, count); dead ones are swapped out, so nothing is ever
+// allocated after InitParticlePool.
+struct ParticlePool {
+    std::vector<float> x, y, vx, vy;
+    std::vector<float> life, fade; // Seconds left, 1 / lifetime (alpha = life * fade)
+    std::vector<float> weight;     // Gravity scale: dust falls, snow drifts
+    std::vector<float> size;       // Edge length in px
+    std::vector<SDL_Color> color;
+    int count = 0;
+    int limit = 0; // Live particles allowed (adaptive quality), at most the capacity
+    Uint32 rng = 0x2545F491u;
+    float weatherDebt = 0; // Snowflakes owed to WEATHER_RATE
+
+    // Render scratch: one quad per particle, indices built once
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+// Many independent players in struct-of-arrays layout, for batched
+// simulation (AI training, level validation). All share one size.
+struct PlayerBatch {
+    std::vector<Scalar> posX, posY;
+    std::vector<Scalar> velX, velY;
+    std::vector<float> onGround;   // 1.0f standing / 0.0f airborne (float so SIMD can load it)
+    std::vector<float> jumpBuffer, coyote; // Player counters, as whole-number floats
+    std::vector<int> ground;               // Collision only, so never loaded into SIMD lanes
+    std::vector<SDL_Point> groundAt;
+    std::vector<InputState> input; // Set by the caller before every step
+    SimVec2 size = { 32, 64 };
+
+    // Per-step lanes derived from 'input'
+    std::vector<float> targetSpeed, jumpPressed, jumpHeld;
+};
+
+// Job System
+// A job runs one [begin, end) slice of a ParallelFor. Plain function pointers
+// keep jobs trivially copyable and allocation free.
+struct Job {
+    void (*run)(void* context, size_t begin, size_t end);
+    void* context;
+    size_t begin, end;
+    std::atomic<int>* remaining; // Unfinished jobs of the owning ParallelFor
+};
+
+// Per-thread deque: the owner pushes/pops at the back, thieves take from the front
+struct JobQueue {
+#ifdef UPHILL_THREADS
+    std::mutex lock;
+#endif
+    std::deque<Job> jobs;
+};
+
+struct JobSystem {
+    int workerCount = 0; // Threads besides the caller; 0 = everything runs inline
+#ifdef UPHILL_THREADS
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<JobQueue>> queues; // One per worker, plus one for the caller (last)
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<int> queued{0};
+    std::atomic<bool> quit{false};
+#endif
+
+    // Throughput counters (relaxed, read them whenever)
+    std::atomic<Uint64> jobsRun{0};
+    std::atomic<Uint64> jobsStolen{0};
+    std::atomic<Uint64> itemsRun{0}; // Sum of (end - begin) over finished jobs
+};
+
+// Input Replays
+// Per-step InputState packed into 4 bits and run-length encoded. Standing
+// still or holding a direction costs about one byte per 15 steps.
+struct ReplayHeader {
+    Uint32 levelId = 0;
+    Uint32 seed = 0;
+    Uint16 physicsHz = PHYSICS_HZ;
+    Uint8 numeric = PHYSICS_NUMERIC; // 0 float, 1 Q16.16 fixed point
+    Uint32 steps = 0;
+};
+
+struct ReplayRecorder {
+    ReplayHeader header;
+    std::vector<Uint8> runs; // Encoded runs (see EncodeReplayRun)
+    Uint8 runState = 0;      // Packed input of the open run
+    Uint32 runLength = 0;    // Steps in the open run (0 = none)
+};
+
+struct Replay {
+    ReplayHeader header;
+    std::vector<Uint8> runs;
+};
+
+// Playback position inside Replay::runs
+struct ReplayCursor {
+    size_t offset = 0;
+    Uint8 state = 0;
+    Uint32 stepsLeft = 0; // Steps left in the current run
+};
+
+// Everything the main loop carries from one frame to the next
+#ifdef UPHILL_PROFILE
+enum ProfilePhase : Uint8 {
+    PROFILE_INPUT,
+    PROFILE_STREAM,
+    PROFILE_PHYSICS, // One scope per physics step
+    PROFILE_PARTICLES, // Emitting and moving particles (drawing them counts as render)
+    PROFILE_RENDER,  // Building and submitting draw calls
+    PROFILE_PRESENT, // SDL_RenderPresent (includes waiting for vsync)
+    PROFILE_PHASE_COUNT,
+};
+
+const char* const PROFILE_PHASE_NAMES[PROFILE_PHASE_COUNT] = { "input", "stream", "physics", "particles", "render", "present" };
+
+struct ProfileEvent {
+    Uint8 phase;
+    Uint64 start, end; // Performance counter ticks
+};
+
+struct ProfileFrame {
+    Uint64 start, end;
+    Uint64 phaseTicks[PROFILE_PHASE_COUNT];
+    int steps;
+};
+
+// Both rings are fixed arrays: recording never allocates
+struct Profiler {
+    ProfileFrame frames[PROFILE_FRAME_HISTORY];
+    ProfileEvent events[PROFILE_EVENT_CAPACITY];
+    Uint32 frameCount; // Frames begun so far (current one is frameCount - 1)
+    Uint32 eventCount; // Events recorded so far
+    bool overlay;      // F3
+};
+#endif
+
+// Session metrics, indexed by counter. Histograms are runs of counters.
+enum TelemetryCounter {
+    TELEMETRY_IDLE_FRAMES,   // Frames not drawn (power saving)
+    TELEMETRY_DROPPED_STEPS, // Physics steps given up on to catch up
+    TELEMETRY_JUMPS,
+    TELEMETRY_DEATHS,        // Falls out of the level
+    TELEMETRY_FRAME_MS,                                             // Drawn frames by time since the previous frame
+    TELEMETRY_WORK_MS = TELEMETRY_FRAME_MS + TELEMETRY_TIME_BUCKETS, // ... by input-to-present time, without the vsync wait
+    TELEMETRY_STEPS_PER_FRAME = TELEMETRY_WORK_MS + TELEMETRY_TIME_BUCKETS, // Every frame, by physics steps run
+    TELEMETRY_COUNTER_COUNT = TELEMETRY_STEPS_PER_FRAME + MAX_STEPS_PER_FRAME + 1,
+};
+
+// Counters are fixed atomics, so recording never allocates or locks. The
+// writer swaps each one back to 0 as it takes a batch.
+struct Telemetry {
+    std::atomic<Uint32> counters[TELEMETRY_COUNTER_COUNT]; // Since the last batch
+    Uint64 totals[TELEMETRY_COUNTER_COUNT]; // Whole session (writer only)
+    char path[512];
+    SDL_RWops* file = nullptr; // nullptr = keep totals only
+    std::vector<Uint8> batch;  // Reused encoding buffer
+    Uint64 start;     // SDL_GetPerformanceCounter() when the session opened
+    Uint32 batches = 0;
+    Uint64 bytes = 0; // Written so far, header included
+#ifdef UPHILL_THREADS
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool quit = false;
+#else
+    Uint64 nextFlush = 0; // Counter time of the next batch (flushed from the frame loop)
+#endif
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Telemetry counters must not take a lock");
+
+// Everything a race step changes. Obstacles are posed from the frame number,
+// so the players are the whole simulation state and a snapshot is a plain copy.
+struct RaceState {
+    Player players[RACE_PLAYERS];
+};
+
+// One peer's view of a race. Remote inputs arrive in frame order, possibly
+// late; until then the remote player is predicted, and a wrong prediction
+// rewinds to the saved state of that frame and re-simulates.
+struct RollbackSession {
+    RaceState state;                        // After simulating frames [0, frame)
+    RaceState snapshots[ROLLBACK_RING];     // State at the start of each recent frame
+    InputState inputs[ROLLBACK_RING][RACE_PLAYERS];
+    int localPlayer;
+    Uint32 frame;           // Next frame to simulate
+    Uint32 remoteConfirmed; // Remote inputs are known for frames before this
+    Uint32 rollbackFrame;   // Earliest mispredicted frame (ROLLBACK_NONE = none)
+    InputState lastRemote;  // Newest confirmed remote input (prediction source)
+    Uint64 rollbacks;
+    Uint64 resimulatedSteps;
+};
+
+// Input events waiting for the physics step their timestamp falls into
+struct InputEventQueue {
+    SDL_Event events[INPUT_QUEUE_CAPACITY];
+    Uint64 times[INPUT_QUEUE_CAPACITY]; // Performance counter time of each event
+    int head = 0;
+    int count = 0;
+};
+
+struct GameLoop {
+    Player player;
+    Player previous; // State before the latest physics step (for interpolation)
+    Camera camera;
+    InputState input;
+    Uint64 lastCounter;  // SDL_GetPerformanceCounter() at the previous frame
+    Uint64 counterFreq;  // SDL_GetPerformanceFrequency()
+    Uint64 accumulator;  // Unsimulated time in counter ticks * PHYSICS_HZ (one step == counterFreq)
+    Uint64 stepCount;    // Physics steps simulated since start
+    Uint64 frameCount;   // Frames run since start
+    ReplayRecorder recorder; // Always on; written out at shutdown
+    char replayPath[512];
+    ChunkStreamer streamer;  // Only open with --stream
+    QualityController quality;
+
+    // Power saving (see SceneSignature)
+    Uint64 presentedScene; // Signature of the frame on screen
+    bool redraw;           // The screen needs drawing whatever the signature says
+    bool idle;             // Nothing changed last frame: sleep until input
+    float restSeconds;     // How long the player has been still with no input
+    Uint64 idleFrames;     // Frames skipped since start
+
+    double firstFrameMs;       // Launch to the first present (0 = not yet)
+    const char* deferredLevel; // Web: --level file, fetched once the first frame is up
+    // Input latency (--low-latency: events go to the step matching their
+    // timestamp, no vsync, frames paced by the limiter instead)
+    bool lowLatency;
+    InputEventQueue pendingInput;
+    Uint64 frameLimitTicks;   // Minimum counter ticks per frame (0 = unlimited / vsync)
+    Uint64 nextFrameTime;     // Counter time the limiter waits for
+    Uint64 jumpPressTime;     // When the unconsumed jump press happened (0 = none)
+    Uint64 jumpStepTime;      // Press time of a jump simulated but not yet presented
+    Uint64 jumpLatencyCount;  // Jump press to present, measured per press
+    double jumpLatencySumMs;
+    double jumpLatencyMaxMs;
 };
 
 // ==========================================
@@ -61,303 +718,3876 @@ struct TouchButton {
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 bool isRunning = true;
-std::vector<Obstacle> obstacles;
+Uint64 launchCounter = 0; // SDL_GetPerformanceCounter() on entering main (time to first frame)
+World world; // The level being played
+Telemetry telemetry; // This session's metrics
 
-// Touch State Tracking
-std::map<SDL_FingerID, Vec2> activeFingers;
-TouchButton btnLeft, btnRight, btnJump;
+// Scratch buffer reused by every physics grid query (one per thread)
+thread_local std::vector<int> broadphaseHits;
 
-// ==========================================
-// SETUP & LEVELS
-// ==========================================
+// Render Batching
+std::vector<int> visibleObstacles; // Scratch buffer for view culling
+std::vector<SDL_Rect> obstacleBatches[OBSTACLE_STYLE_COUNT]; // One rect list per style
+SDL_Texture* staticLayer = nullptr; // Baked level geometry (nullptr = draw batches)
+SDL_Rect staticLayerBounds = { 0, 0, 0, 0 };
+SDL_Texture* tileAtlas = nullptr; // nullptr = flat colored rects
+int tileAtlasWidth = 0, tileAtlasHeight = 0;
+TileBatch levelTiles; // Obstacle layer
+TileBatch actorTiles; // Player layer
+ParticlePool particles; // Dust, jump trails and weather
+SDL_Texture* sceneTarget = nullptr; // World layer below full render scale (created on first use)
+bool sceneTargetTried = false;      // Creation was attempted (sceneTarget stays nullptr if unsupported)
 
-void InitControls() {
-    // Bottom Left Corner
-    btnLeft =  { {50, 550, 150, 150}, "Left", false };
-    btnRight = { {250, 550, 150, 150}, "Right", false };
-    
-    // Bottom Right Corner
-    btnJump =  { {1030, 550, 200, 150}, "Jump", false };
-}
+#ifdef UPHILL_COUNT_ALLOCATIONS
+// Replaced global new: counts per thread, so background loaders don't show up.
+// Every plain, array and nothrow form is replaced together, so nothing the
+// runtime allocates reaches our free() (sanitizers flag that as a mismatch).
+// The aligned forms stay the runtime's own matching pair, uncounted.
+thread_local Uint64 threadAllocations = 0;
+int allocationReports = 0;
 
-void LoadLevel() {
-    obstacles.clear();
-    // 1. Floor
-    obstacles.push_back({ {0, 600, 1280, 120}, 0 });
-    // 2. Steps
-    obstacles.push_back({ {300, 500, 200, 20}, 0 });
-    obstacles.push_back({ {600, 400, 200, 20}, 0 });
-    obstacles.push_back({ {900, 250, 300, 20}, 0 });
-    // 3. Walls & Ceiling
-    obstacles.push_back({ {-50, 0, 50, 720}, 0 });
-    obstacles.push_back({ {1280, 0, 50, 720}, 0 });
-    obstacles.push_back({ {400, 200, 100, 20}, 0 });
+void* CountedAlloc(size_t size) noexcept {
+    threadAllocations++;
+    return malloc(size ? size : 1);
 }
 
-bool CheckCollision(const SDL_Rect& a, const SDL_Rect& b) {
-    return (a.x < b.x + b.w && a.x + a.w > b.x &&
-            a.y < b.y + b.h && a.y + a.h > b.y);
+void* operator new(size_t size) {
+    if (void* p = CountedAlloc(size)) return p;
+    throw std::bad_alloc();
 }
-
-bool IsPointInRect(float x, float y, const SDL_Rect& r) {
-    return (x >= r.x && x <= r.x + r.w && y >= r.y && y <= r.y + r.h);
+void* operator new[](size_t size) {
+    if (void* p = CountedAlloc(size)) return p;
+    throw std::bad_alloc();
 }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+#endif
+
+#ifdef UPHILL_PROFILE
+Profiler profiler;
+std::vector<SDL_Rect> profileRects; // Scratch for overlay drawing
+#endif
+
+// Touch State Tracking
+TouchTable activeFingers;
+
+// Keyboard State Tracking (from events, so queued events replay correctly)
+bool keyLeftHeld = false, keyRightHeld = false, keyJumpHeld = false;
+TouchButton buttons[BUTTON_COUNT];
 
 // ==========================================
-// INPUT HANDLING (KEYBOARD + TOUCH)
+// SPATIAL INDEX
 // ==========================================
 
-void HandleInput(InputState& input) {
-    SDL_Event e;
-    
-    // Reset "Frame Perfect" inputs
-    input.jumpPressed = false;
+// Maps a world coordinate to a cell column/row. Anything outside the grid is
+// clamped into the border cells, so late inserts beyond the original bounds
+// still get found by queries (they just share the edge cell).
+int GridCell(int v, int origin, int count) {
+    int c = (v - origin) / GRID_CELL_SIZE;
+    if (v < origin && (v - origin) % GRID_CELL_SIZE != 0) c--; // Floor for negatives
+    return std::clamp(c, 0, count - 1);
+}
 
-    // 1. Event Polling
-    while (SDL_PollEvent(&e) != 0) {
-        if (e.type == SDL_QUIT) {
-            isRunning = false;
-        }
-        // --- KEYBOARD (PC Testing) ---
-        else if (e.type == SDL_KEYDOWN) {
-            if (e.key.keysym.sym == SDLK_ESCAPE) isRunning = false;
-            if (e.key.keysym.sym == SDLK_SPACE && !e.key.repeat) {
-                input.jumpPressed = true;
-                input.jumpHeld = true;
-            }
-        }
-        else if (e.type == SDL_KEYUP) {
-            if (e.key.keysym.sym == SDLK_SPACE) input.jumpHeld = false;
-        }
-        
-        // --- TOUCH (Android) ---
-        // We track fingers manually to support multi-touch (e.g., Run + Jump)
-        else if (e.type == SDL_FINGERDOWN || e.type == SDL_FINGERMOTION) {
-            // Convert normalized (0..1) to Logical (0..1280)
-            float x = e.tfinger.x * SCREEN_WIDTH;
-            float y = e.tfinger.y * SCREEN_HEIGHT;
-            activeFingers[e.tfinger.fingerId] = { x, y };
-
-            // Check if this specific touch *just* hit the jump button (Tap event)
-            if (e.type == SDL_FINGERDOWN && IsPointInRect(x, y, btnJump.rect)) {
-                input.jumpPressed = true;
+void GridCellRange(const SpatialGrid& grid, const SDL_Rect& r, int& x0, int& y0, int& x1, int& y1) {
+    x0 = GridCell(r.x, grid.originX, grid.cols);
+    y0 = GridCell(r.y, grid.originY, grid.rows);
+    x1 = GridCell(r.x + std::max(r.w - 1, 0), grid.originX, grid.cols);
+    y1 = GridCell(r.y + std::max(r.h - 1, 0), grid.originY, grid.rows);
+}
+
+void InsertIntoSpatialGrid(SpatialGrid& grid, int index, const SDL_Rect& rect) {
+    int x0, y0, x1, y1;
+    GridCellRange(grid, rect, x0, y0, x1, y1);
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            int node = grid.freeNode;
+            if (node >= 0) {
+                grid.freeNode = grid.nodeNext[node];
+            } else {
+                node = (int)grid.nodeObstacle.size();
+                grid.nodeObstacle.push_back(0);
+                grid.nodeNext.push_back(-1);
             }
-        }
-        else if (e.type == SDL_FINGERUP) {
-            activeFingers.erase(e.tfinger.fingerId);
+            int& head = grid.cellHead[cy * grid.cols + cx];
+            grid.nodeObstacle[node] = index;
+            grid.nodeNext[node] = head;
+            head = node;
         }
     }
+}
 
-    // 2. Continuous State Checking
-    // Reset continuous flags
-    input.left = false;
-    input.right = false;
-    
-    // Keyboard Continuous
-    const Uint8* keys = SDL_GetKeyboardState(NULL);
-    if (keys[SDL_SCANCODE_LEFT]) input.left = true;
-    if (keys[SDL_SCANCODE_RIGHT]) input.right = true;
-
-    // Touch Continuous (Loop through all active fingers)
-    bool touchJumpHeld = false;
-    
-    // Reset visual feedback
-    btnLeft.active = false;
-    btnRight.active = false;
-    btnJump.active = false;
+// 'rect' must be the rect the obstacle was inserted with.
+void RemoveFromSpatialGrid(SpatialGrid& grid, int index, const SDL_Rect& rect) {
+    int x0, y0, x1, y1;
+    GridCellRange(grid, rect, x0, y0, x1, y1);
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            int* link = &grid.cellHead[cy * grid.cols + cx];
+            while (*link >= 0 && grid.nodeObstacle[*link] != index) link = &grid.nodeNext[*link];
+            if (*link < 0) continue;
 
-    for (auto const& [id, pos] : activeFingers) {
-        if (IsPointInRect(pos.x, pos.y, btnLeft.rect)) {
-            input.left = true;
-            btnLeft.active = true;
-        }
-        if (IsPointInRect(pos.x, pos.y, btnRight.rect)) {
-            input.right = true;
-            btnRight.active = true;
-        }
-        if (IsPointInRect(pos.x, pos.y, btnJump.rect)) {
-            touchJumpHeld = true;
-            btnJump.active = true;
+            int node = *link;
+            *link = grid.nodeNext[node];
+            grid.nodeNext[node] = grid.freeNode;
+            grid.freeNode = node;
         }
     }
-    
-    // Merge Keyboard and Touch for Jump Hold
-    input.jumpHeld = (touchJumpHeld || keys[SDL_SCANCODE_SPACE]);
 }
 
-// ==========================================
-// PHYSICS
-// ==========================================
+// Patch the grid after an obstacle changed its rect. Cheap when it stays
+// within the same cells, which is the common case for small moves.
+void MoveInSpatialGrid(SpatialGrid& grid, int index, const SDL_Rect& oldRect, const SDL_Rect& newRect) {
+    int ox0, oy0, ox1, oy1, nx0, ny0, nx1, ny1;
+    GridCellRange(grid, oldRect, ox0, oy0, ox1, oy1);
+    GridCellRange(grid, newRect, nx0, ny0, nx1, ny1);
+    if (ox0 == nx0 && oy0 == ny0 && ox1 == nx1 && oy1 == ny1) return;
 
-void UpdatePhysics(Player& player, const InputState& input, float dt) {
-    // 1. Horizontal
-    float targetSpeed = 0.0f;
-    if (input.left) targetSpeed = -MOVE_SPEED;
-    if (input.right) targetSpeed = MOVE_SPEED;
+    RemoveFromSpatialGrid(grid, index, oldRect);
+    InsertIntoSpatialGrid(grid, index, newRect);
+}
+
+// Bounding box of all obstacles (empty rect for an empty list).
+SDL_Rect ComputeLevelBounds(const std::vector<Obstacle>& list) {
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool first = true;
+    for (size_t i = 0; i < list.size(); i++) {
+        const SDL_Rect& r = list[i].rect;
+        if (list[i].type == OBSTACLE_FREE) continue;
+        if (first || r.x < minX) minX = r.x;
+        if (first || r.y < minY) minY = r.y;
+        if (first || r.x + r.w > maxX) maxX = r.x + r.w;
+        if (first || r.y + r.h > maxY) maxY = r.y + r.h;
+        first = false;
+    }
+    return { minX, minY, maxX - minX, maxY - minY };
+}
 
-    float friction = player.onGround ? FRICTION : AIR_FRICTION;
+// Empty grid covering 'bounds'.
+void ResetSpatialGrid(SpatialGrid& grid, const SDL_Rect& bounds) {
+    grid.originX = bounds.x;
+    grid.originY = bounds.y;
+    grid.cols = std::max(1, (bounds.w + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE);
+    grid.rows = std::max(1, (bounds.h + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE);
+    grid.cellHead.assign((size_t)grid.cols * grid.rows, -1);
+    grid.nodeObstacle.clear();
+    grid.nodeNext.clear();
+    grid.freeNode = -1;
+}
 
-    if (player.vel.x < targetSpeed) {
-        player.vel.x += ACCELERATION * dt;
-        if (player.vel.x > targetSpeed) player.vel.x = targetSpeed;
+// Full rebuild, sized to the bounding box of the given obstacles.
+void BuildSpatialGrid(SpatialGrid& grid, const std::vector<Obstacle>& list) {
+    ResetSpatialGrid(grid, ComputeLevelBounds(list));
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i].type != OBSTACLE_FREE) InsertIntoSpatialGrid(grid, (int)i, list[i].rect);
     }
-    else if (player.vel.x > targetSpeed) {
-        player.vel.x -= ACCELERATION * dt;
-        if (player.vel.x < targetSpeed) player.vel.x = targetSpeed;
+}
+
+bool IsDynamicObstacle(int type) {
+    return type == OBSTACLE_MOVING || type == OBSTACLE_CRUMBLING || type == OBSTACLE_ELEVATOR;
+}
+
+// Adds an obstacle to a live world (reusing a free slot) and indexes it.
+int AddObstacle(World& level, const Obstacle& obs) {
+    int index;
+    if (!level.freeSlots.empty()) {
+        index = level.freeSlots.back();
+        level.freeSlots.pop_back();
+        level.obstacles[index] = obs;
+    } else {
+        index = (int)level.obstacles.size();
+        level.obstacles.push_back(obs);
     }
+    InsertIntoSpatialGrid(level.grid, index, obs.rect);
+    if (IsDynamicObstacle(obs.type)) level.dynamics.push_back({ index, obs.rect, obs.rect, true });
+    return index;
+}
 
-    if (targetSpeed == 0.0f) {
-        if (player.vel.x > 0) {
-            player.vel.x -= friction * dt;
-            if (player.vel.x < 0) player.vel.x = 0;
-        } else if (player.vel.x < 0) {
-            player.vel.x += friction * dt;
-            if (player.vel.x > 0) player.vel.x = 0;
+// Removes an obstacle from a live world. Other indices stay valid.
+void RemoveObstacle(World& level, int index) {
+    Obstacle& obs = level.obstacles[index];
+    if (obs.type == OBSTACLE_FREE) return;
+    if (IsDynamicObstacle(obs.type)) {
+        // Dynamic obstacles are few, so a linear pass over them is fine
+        for (size_t k = 0; k < level.dynamics.size(); k++) {
+            if (level.dynamics[k].index != index) continue;
+            level.dynamics[k] = level.dynamics.back();
+            level.dynamics.pop_back();
+            break;
         }
     }
+    RemoveFromSpatialGrid(level.grid, index, obs.rect); // No-op if it had crumbled away
+    obs.type = OBSTACLE_FREE;
+    level.freeSlots.push_back(index);
+}
 
-    // 2. Jumping
-    // Initial Jump
-    if (input.jumpPressed && player.onGround) {
-        player.vel.y = JUMP_FORCE;
-        player.onGround = false;
+// Collects every obstacle whose cells overlap 'rect' into 'out', sorted by
+// index and without duplicates (so callers see them in level order).
+// This is only a broadphase: callers still need an exact overlap test.
+void QuerySpatialGrid(const SpatialGrid& grid, const SDL_Rect& rect, std::vector<int>& out) {
+    out.clear();
+    if (grid.cellHead.empty()) return;
+
+    int x0, y0, x1, y1;
+    GridCellRange(grid, rect, x0, y0, x1, y1);
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (int node = grid.cellHead[cy * grid.cols + cx]; node >= 0; node = grid.nodeNext[node]) {
+                out.push_back(grid.nodeObstacle[node]);
+            }
+        }
     }
-    // Variable Jump Height (Celeste Mechanic)
-    // If we release the button while moving up, cut the speed
-    if (!input.jumpHeld && player.vel.y < 0) {
-        player.vel.y *= 0.5f; 
+
+    if (x0 != x1 || y0 != y1) {
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
     }
+}
 
-    // 3. Gravity
-    player.vel.y += GRAVITY * dt;
-    if (player.vel.y > MAX_FALL_SPEED) player.vel.y = MAX_FALL_SPEED;
+// Obstacles as authored: what gets drawn and saved
+const std::vector<Obstacle>& AuthoredObstacles(const World& level) {
+    return level.visuals.empty() ? level.obstacles : level.visuals;
+}
 
-    // 4. Movement & Collision (Axis Separated)
-    // X Axis
-    player.pos.x += player.vel.x * dt;
-    SDL_Rect pRect = { (int)player.pos.x, (int)player.pos.y, (int)player.size.x, (int)player.size.y };
-    for (const auto& obs : obstacles) {
-        if (CheckCollision(pRect, obs.rect)) {
-            if (player.vel.x > 0) player.pos.x = (float)(obs.rect.x - player.size.x);
-            else if (player.vel.x < 0) player.pos.x = (float)(obs.rect.x + obs.rect.w);
-            player.vel.x = 0;
-        }
+const SpatialGrid& AuthoredGrid(const World& level) {
+    return level.visuals.empty() ? level.grid : level.visualGrid;
+}
+
+// Level-build pass: greedily merges touching static solid rects, first into
+// runs along x (same top and height), then stacks of those runs (same left
+// and width). Tile layouts collapse to a few big colliders, so physics sees
+// far fewer candidates and no seams to snag on. 'level.grid' must index
+// 'level.obstacles'; the originals and their grid move to 'visuals'.
+void MergeCollisionRects(World& level) {
+    std::vector<Obstacle> merged, colliders;
+    for (const auto& obs : level.obstacles) {
+        if (obs.type == OBSTACLE_SOLID) merged.push_back(obs);
+        else if (obs.type != OBSTACLE_FREE) colliders.push_back(obs); // Dynamic ones stay as they are
     }
+    size_t solidCount = merged.size();
 
-    // Y Axis
-    player.pos.y += player.vel.y * dt;
-    player.onGround = false;
-    pRect.x = (int)player.pos.x;
-    pRect.y = (int)player.pos.y;
-    for (const auto& obs : obstacles) {
-        if (CheckCollision(pRect, obs.rect)) {
-            if (player.vel.y > 0) {
-                player.pos.y = (float)(obs.rect.y - player.size.y);
-                player.onGround = true;
-                player.vel.y = 0;
-            } else if (player.vel.y < 0) {
-                player.pos.y = (float)(obs.rect.y + obs.rect.h);
-                player.vel.y = 0;
+    auto mergeRuns = [&merged](bool alongX) {
+        std::sort(merged.begin(), merged.end(), [alongX](const Obstacle& a, const Obstacle& b) {
+            const SDL_Rect& p = a.rect;
+            const SDL_Rect& q = b.rect;
+            if (alongX) return std::tie(p.y, p.h, p.x, p.w) < std::tie(q.y, q.h, q.x, q.w);
+            return std::tie(p.x, p.w, p.y, p.h) < std::tie(q.x, q.w, q.y, q.h);
+        });
+        size_t out = 0;
+        for (size_t i = 0; i < merged.size(); i++) {
+            SDL_Rect& last = merged[out].rect;
+            const SDL_Rect& r = merged[i].rect;
+            if (i > 0 && alongX && r.y == last.y && r.h == last.h && r.x <= last.x + last.w) {
+                last.w = std::max(last.x + last.w, r.x + r.w) - last.x;
+            } else if (i > 0 && !alongX && r.x == last.x && r.w == last.w && r.y <= last.y + last.h) {
+                last.h = std::max(last.y + last.h, r.y + r.h) - last.y;
+            } else {
+                merged[i > 0 ? ++out : out] = merged[i];
             }
         }
-    }
+        if (!merged.empty()) merged.resize(out + 1);
+    };
+    mergeRuns(true);
+    mergeRuns(false);
 
-    // World Bounds
-    if (player.pos.y > SCREEN_HEIGHT + 100) {
-        player.pos = { 100, 500 };
-        player.vel = { 0, 0 };
-    }
+    level.visuals.clear();
+    if (merged.size() == solidCount) return; // Nothing touched; keep one copy
+
+    SDL_Log("Level %u: %u solid obstacles merged into %u colliders",
+            level.levelId, (unsigned)solidCount, (unsigned)merged.size());
+    colliders.insert(colliders.end(), merged.begin(), merged.end());
+    level.visuals.swap(level.obstacles);
+    std::swap(level.visualGrid, level.grid);
+    level.obstacles.swap(colliders);
+    level.freeSlots.clear();
+    BuildSpatialGrid(level.grid, level.obstacles);
 }
 
 // ==========================================
-// RENDERING
+// DYNAMIC OBSTACLES
 // ==========================================
 
-void RenderButton(const TouchButton& btn) {
-    // Draw Outline
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 150);
-    SDL_RenderDrawRect(renderer, &btn.rect);
+// Every pose is a pure function of the physics step, so rewinding for a
+// rollback or running sessions in lockstep needs no saved obstacle state.
 
-    // Draw Fill (Visual feedback when pressed)
-    if (btn.active) {
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 100);
-        SDL_RenderFillRect(renderer, &btn.rect);
-    }
+// Offset along a back and forth path: 0 .. distance .. 0, holding 'waitSteps'
+// at each end.
+int PingPong(Uint32 t, int distance, int travelSteps, int waitSteps) {
+    int k = (int)(t % (Uint32)(2 * (travelSteps + waitSteps)));
+    if (k < waitSteps) return 0;
+    k -= waitSteps;
+    if (k < travelSteps) return distance * k / travelSteps;
+    k -= travelSteps;
+    if (k < waitSteps) return distance;
+    k -= waitSteps;
+    return distance - distance * k / travelSteps;
 }
 
-void Render(const Player& player) {
-    SDL_SetRenderDrawColor(renderer, 135, 206, 235, 255); // Sky Blue
-    SDL_RenderClear(renderer);
+// Rect of a dynamic obstacle at 'step'; false while it is crumbled away.
+bool PoseDynamicObstacle(int type, const SDL_Rect& home, Uint32 step, SDL_Rect& rect) {
+    Uint32 t = step + (Uint32)(home.x + home.y); // Phase from the position, so neighbors don't move in sync
+    rect = home;
+    if (type == OBSTACLE_MOVING) {
+        rect.x += PingPong(t, MOVING_TRAVEL, MOVING_TRAVEL_STEPS, 0);
+    } else if (type == OBSTACLE_ELEVATOR) {
+        rect.y -= PingPong(t, ELEVATOR_TRAVEL, ELEVATOR_TRAVEL_STEPS, ELEVATOR_WAIT_STEPS);
+    } else if (type == OBSTACLE_CRUMBLING) {
+        return t % (Uint32)(CRUMBLE_SOLID_STEPS + CRUMBLE_GONE_STEPS) < (Uint32)CRUMBLE_SOLID_STEPS;
+    }
+    return true;
+}
 
-    // Obstacles
-    SDL_SetRenderDrawColor(renderer, 34, 139, 34, 255); // Forest Green
-    for (const auto& obs : obstacles) {
-        SDL_RenderFillRect(renderer, &obs.rect);
-        SDL_SetRenderDrawColor(renderer, 0, 100, 0, 255); // Border
-        SDL_RenderDrawRect(renderer, &obs.rect);
-        SDL_SetRenderDrawColor(renderer, 34, 139, 34, 255);
+// Lists the dynamic obstacles of a freshly loaded level, at their home rects.
+void CollectDynamicObstacles(World& level) {
+    level.dynamics.clear();
+    for (size_t i = 0; i < level.obstacles.size(); i++) {
+        const Obstacle& obs = level.obstacles[i];
+        if (IsDynamicObstacle(obs.type)) level.dynamics.push_back({ (int)i, obs.rect, obs.rect, true });
     }
+}
 
-    // Player
-    SDL_Rect pRect = { (int)player.pos.x, (int)player.pos.y, (int)player.size.x, (int)player.size.y };
-    SDL_SetRenderDrawColor(renderer, 255, 69, 0, 255); // Red-Orange
-    SDL_RenderFillRect(renderer, &pRect);
+// Moves a dynamic obstacle (or all of them) to its pose at 'step'. The grid
+// is patched only for obstacles that changed cells; static ones are never touched.
+void PoseDynamicObstacle(World& level, DynamicObstacle& d, Uint32 step) {
+    Obstacle& obs = level.obstacles[d.index];
+    SDL_Rect rect;
+    bool solid = PoseDynamicObstacle(obs.type, d.home, step, rect);
+    if (solid != d.solid) {
+        if (solid) InsertIntoSpatialGrid(level.grid, d.index, rect);
+        else RemoveFromSpatialGrid(level.grid, d.index, obs.rect);
+        d.solid = solid;
+    } else if (solid && (rect.x != obs.rect.x || rect.y != obs.rect.y)) {
+        MoveInSpatialGrid(level.grid, d.index, obs.rect, rect);
+    }
+    d.previous = obs.rect;
+    obs.rect = rect;
+}
 
-    // UI (On-Screen Controls)
-    RenderButton(btnLeft);
-    RenderButton(btnRight);
-    RenderButton(btnJump);
+void PoseDynamicObstacles(World& level, Uint32 step) {
+    for (DynamicObstacle& d : level.dynamics) PoseDynamicObstacle(level, d, step);
+}
 
-    SDL_RenderPresent(renderer);
+// Rect covering every pose of a dynamic obstacle
+SDL_Rect DynamicObstacleReach(int type, const SDL_Rect& home) {
+    SDL_Rect reach = home;
+    if (type == OBSTACLE_MOVING) reach.w += MOVING_TRAVEL;
+    if (type == OBSTACLE_ELEVATOR) {
+        reach.y -= ELEVATOR_TRAVEL;
+        reach.h += ELEVATOR_TRAVEL;
+    }
+    return reach;
 }
 
 // ==========================================
-// MAIN
+// SETUP & LEVELS
 // ==========================================
 
-int main(int argc, char* argv[]) {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) return -1;
-
-    window = SDL_CreateWindow("Uphill Proto", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+void InitControls() {
+    // Bottom Left Corner
+    buttons[BUTTON_LEFT] =  { {50, 550, 150, 150}, "Left", 0, 0 };
+    buttons[BUTTON_RIGHT] = { {250, 550, 150, 150}, "Right", 0, 0 };
     
-    // Critical for Android: Scale 1280x720 logic to whatever the phone screen is
-    SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    // Bottom Right Corner
+    buttons[BUTTON_JUMP] =  { {1030, 550, 200, 150}, "Jump", 0, 0 };
+}
 
-    InitControls();
-    LoadLevel();
+void LoadLevel(World& level) {
+    std::vector<Obstacle>& obstacles = level.obstacles;
+    obstacles.clear();
+    // 1. Floor
+    obstacles.push_back({ {0, 600, 1280, 120}, 0 });
+    // 2. Steps
+    obstacles.push_back({ {300, 500, 200, 20}, 0 });
+    obstacles.push_back({ {600, 400, 200, 20}, 0 });
+    obstacles.push_back({ {900, 250, 300, 20}, 0 });
+    // 3. Walls & Ceiling
+    obstacles.push_back({ {-50, 0, 50, 720}, 0 });
+    obstacles.push_back({ {1280, 0, 50, 720}, 0 });
+    obstacles.push_back({ {400, 200, 100, 20}, 0 });
+    // 4. Moving Parts
+    obstacles.push_back({ {700, 500, 120, 20}, OBSTACLE_MOVING }); // Clears a player on the floor and one on it clears the step above
+    obstacles.push_back({ {1200, 580, 80, 20}, OBSTACLE_ELEVATOR });
+    obstacles.push_back({ {100, 380, 120, 20}, OBSTACLE_CRUMBLING });
+
+    // This level fits on one screen; the walls sit just outside of it
+    level.cameraBounds = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    level.levelId = 1;
 
+    BuildSpatialGrid(level.grid, obstacles);
+    MergeCollisionRects(level);
+    CollectDynamicObstacles(level);
+}
+
+Player SpawnPlayer() {
     Player player;
     player.pos = { 100, 500 };
     player.vel = { 0, 0 };
     player.size = { 32, 64 };
     player.onGround = false;
+    player.jumpBuffer = 0;
+    player.coyote = 0;
+    player.ground = -1;
+    player.groundAt = { 0, 0 };
+    return player;
+}
 
-    InputState inputState;
-
-    Uint64 lastTime = SDL_GetTicks64();
-    float accumulator = 0.0f;
-
-    while (isRunning) {
-        Uint64 currentTime = SDL_GetTicks64();
-        float frameTime = (currentTime - lastTime) / 1000.0f;
-        lastTime = currentTime;
-        if (frameTime > 0.25f) frameTime = 0.25f;
-
-        accumulator += frameTime;
-
-        HandleInput(inputState);
+// Q16.16 positions wrap past +-32767 px
+const int FIXED_POINT_LIMIT = 32767 - SCREEN_HEIGHT; // px; leaves room for the respawn check below the level
 
-        while (accumulator >= TIME_STEP) {
-            UpdatePhysics(player, inputState, TIME_STEP);
-            accumulator -= TIME_STEP;
-        }
+bool FitsFixedPointRange(const World& level) {
+    const SDL_Rect& b = level.cameraBounds;
+    return b.x >= -FIXED_POINT_LIMIT && b.y >= -FIXED_POINT_LIMIT &&
+           b.x + b.w <= FIXED_POINT_LIMIT && b.y + b.h <= FIXED_POINT_LIMIT;
+}
 
-        Render(player);
+// Fixed-point builds say so instead of teleporting players
+void WarnFixedPointRange(const World& level) {
+#ifdef UPHILL_FIXED_POINT
+    if (!FitsFixedPointRange(level)) {
+        const SDL_Rect& b = level.cameraBounds;
+        SDL_Log("Level %u spans (%d,%d)-(%d,%d), outside the fixed-point range of +-%d px",
+                level.levelId, b.x, b.y, b.x + b.w, b.y + b.h, FIXED_POINT_LIMIT);
     }
+#else
+    (void)level;
+#endif
+}
 
-    SDL_DestroyRenderer(renderer);
+bool CheckCollision(const SDL_Rect& a, const SDL_Rect& b) {
+    return (a.x < b.x + b.w && a.x + a.w > b.x &&
+            a.y < b.y + b.h && a.y + a.h > b.y);
+}
+
+bool IsPointInRect(float x, float y, const SDL_Rect& r) {
+    return (x >= r.x && x <= r.x + r.w && y >= r.y && y <= r.y + r.h);
+}
+
+// ==========================================
+// LEVEL FILES
+// ==========================================
+
+// Read-only view of a whole file: memory-mapped where we can, otherwise read
+// into one buffer (Android assets, web, Windows).
+struct MappedFile {
+    const Uint8* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::vector<Uint8> buffer;
+};
+
+bool MapFile(const char* path, MappedFile& file) {
+#ifdef UPHILL_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        void* view = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (view != MAP_FAILED) {
+            file.data = (const Uint8*)view;
+            file.size = (size_t)info.st_size;
+            file.mapped = true;
+            return true;
+        }
+    }
+#endif
+    SDL_RWops* rw = SDL_RWFromFile(path, "rb");
+    if (!rw) return false;
+    Sint64 size = SDL_RWsize(rw);
+    file.buffer.resize(size > 0 ? (size_t)size : 0);
+    bool ok = !file.buffer.empty() && SDL_RWread(rw, file.buffer.data(), 1, file.buffer.size()) == file.buffer.size();
+    SDL_RWclose(rw);
+    file.data = file.buffer.data();
+    file.size = file.buffer.size();
+    return ok;
+}
+
+void UnmapFile(MappedFile& file) {
+#ifdef UPHILL_MMAP
+    if (file.mapped) munmap((void*)file.data, file.size);
+#endif
+    file = MappedFile();
+}
+
+// True if a serialized grid's indices are all in range and every cell's
+// chain ends (visiting no node twice, so cycles and shared nodes fail too).
+bool ValidGridArrays(const Sint32* cellHead, size_t cells, const Sint32* nodeObstacle, const Sint32* nodeNext,
+                     Uint32 nodeCount, Uint32 obstacleCount) {
+    for (Uint32 n = 0; n < nodeCount; n++) {
+        if (nodeObstacle[n] < 0 || (Uint32)nodeObstacle[n] >= obstacleCount) return false;
+        if (nodeNext[n] < -1 || nodeNext[n] >= (Sint32)nodeCount) return false;
+    }
+    Uint64 visited = 0;
+    for (size_t c = 0; c < cells; c++) {
+        if (cellHead[c] < -1 || cellHead[c] >= (Sint32)nodeCount) return false;
+        for (Sint32 n = cellHead[c]; n != -1; n = nodeNext[n]) {
+            if (++visited > nodeCount) return false;
+        }
+    }
+    return true;
+}
+
+// Fills 'level' from an in-memory level file. Each array is copied with one
+// bulk assign, so loading costs a handful of allocations however big the level is.
+bool LoadLevelFromMemory(World& level, const Uint8* data, size_t size) {
+    LevelFileHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != LEVEL_MAGIC || header.version != LEVEL_VERSION) return false;
+
+    // Counts are checked one at a time so a corrupt header can't overflow the sum
+    size_t bytes = size - sizeof(header);
+    if (header.obstacleCount > bytes / sizeof(Obstacle)) return false;
+    bytes -= (size_t)header.obstacleCount * sizeof(Obstacle);
+    if (header.chunkCount > bytes / sizeof(LevelChunk)) return false;
+    bytes -= (size_t)header.chunkCount * sizeof(LevelChunk);
+    size_t cols = (size_t)std::max(header.gridCols, 0), rows = (size_t)std::max(header.gridRows, 0);
+    if (rows > 0 && cols > bytes / sizeof(Sint32) / rows) return false;
+    size_t cells = cols * rows;
+    if (header.gridNodeCount > (bytes / sizeof(Sint32) - cells) / 2) return false;
+
+    const Uint8* cursor = data + sizeof(header);
+    const Obstacle* records = (const Obstacle*)cursor;
+    level.obstacles.assign(records, records + header.obstacleCount);
+    level.freeSlots.clear();
+    level.streaming = false;
+    cursor += header.obstacleCount * sizeof(Obstacle);
+    cursor += header.chunkCount * sizeof(LevelChunk); // Only the streamer needs the chunk table
+
+    const Sint32* ints = (const Sint32*)cursor;
+    if (header.gridCellSize == GRID_CELL_SIZE && cells > 0 &&
+        ValidGridArrays(ints, cells, ints + cells, ints + cells + header.gridNodeCount, header.gridNodeCount, header.obstacleCount)) {
+        level.grid.originX = header.gridOriginX;
+        level.grid.originY = header.gridOriginY;
+        level.grid.cols = header.gridCols;
+        level.grid.rows = header.gridRows;
+        level.grid.cellHead.assign(ints, ints + cells);
+        level.grid.nodeObstacle.assign(ints + cells, ints + cells + header.gridNodeCount);
+        level.grid.nodeNext.assign(ints + cells + header.gridNodeCount, ints + cells + 2 * header.gridNodeCount);
+        level.grid.freeNode = -1;
+    } else {
+        // Other cell size, or a corrupt index: rebuild it from the obstacles
+        BuildSpatialGrid(level.grid, level.obstacles);
+    }
+
+    level.levelId = header.levelId;
+    level.cameraBounds = header.cameraBounds;
+    MergeCollisionRects(level);
+    CollectDynamicObstacles(level);
+    WarnFixedPointRange(level);
+    return true;
+}
+
+bool LoadLevelFile(World& level, const char* path) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    MappedFile file;
+    bool ok = MapFile(path, file) && LoadLevelFromMemory(level, file.data, file.size);
+    bool mapped = file.mapped;
+    UnmapFile(file);
+
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (ok) {
+        SDL_Log("Level %u: %u obstacles from %s in %.2f ms (%s)", level.levelId,
+                (unsigned)AuthoredObstacles(level).size(), path, ms, mapped ? "mapped" : "read");
+    } else {
+        SDL_Log("Couldn't load level %s", path);
+    }
+    return ok;
+}
+
+// Writes 'level' sorted into chunks, with a freshly built (compact) spatial index.
+bool SaveLevelFile(const World& level, const char* path) {
+    // Loading merges again, so the file keeps the authored obstacles
+    const std::vector<Obstacle>& authored = AuthoredObstacles(level);
+    SDL_Rect bounds = ComputeLevelBounds(authored);
+    auto chunkOf = [&](const Obstacle& obs) { return (obs.rect.y - bounds.y) / LEVEL_CHUNK_HEIGHT; };
+
+    std::vector<Obstacle> sorted;
+    for (const auto& obs : authored) {
+        if (obs.type != OBSTACLE_FREE) sorted.push_back(obs);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [&](const Obstacle& a, const Obstacle& b) { return chunkOf(a) < chunkOf(b); });
+
+    std::vector<LevelChunk> chunks((size_t)std::max(1, (bounds.h + LEVEL_CHUNK_HEIGHT - 1) / LEVEL_CHUNK_HEIGHT));
+    for (size_t k = 0; k < chunks.size(); k++) {
+        chunks[k] = { 0, 0, bounds.y + (int)k * LEVEL_CHUNK_HEIGHT, bounds.y + (int)k * LEVEL_CHUNK_HEIGHT };
+    }
+    for (size_t i = 0; i < sorted.size(); i++) {
+        LevelChunk& chunk = chunks[chunkOf(sorted[i])];
+        if (chunk.obstacleCount == 0) chunk.firstObstacle = (Uint32)i;
+        chunk.obstacleCount++;
+        // Everywhere the obstacle can be, so an elevator still in view keeps its chunk resident
+        SDL_Rect extent = IsDynamicObstacle(sorted[i].type) ? DynamicObstacleReach(sorted[i].type, sorted[i].rect) : sorted[i].rect;
+        chunk.top = std::min(chunk.top, extent.y);
+        chunk.bottom = std::max(chunk.bottom, extent.y + extent.h);
+    }
+
+    SpatialGrid grid;
+    BuildSpatialGrid(grid, sorted);
+
+    LevelFileHeader header;
+    header.magic = LEVEL_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.levelId = level.levelId;
+    header.cameraBounds = level.cameraBounds;
+    header.gridCellSize = GRID_CELL_SIZE;
+    header.gridOriginX = grid.originX;
+    header.gridOriginY = grid.originY;
+    header.gridCols = grid.cols;
+    header.gridRows = grid.rows;
+    header.gridNodeCount = (Uint32)grid.nodeObstacle.size();
+    header.chunkHeight = LEVEL_CHUNK_HEIGHT;
+    header.chunkCount = (Uint32)chunks.size();
+    header.obstacleCount = (Uint32)sorted.size();
+
+    SDL_RWops* rw = SDL_RWFromFile(path, "wb");
+    if (!rw) return false;
+    bool ok = SDL_RWwrite(rw, &header, sizeof(header), 1) == 1;
+    if (ok && !sorted.empty()) {
+        ok = SDL_RWwrite(rw, sorted.data(), sizeof(Obstacle), sorted.size()) == sorted.size();
+    }
+    if (ok) ok = SDL_RWwrite(rw, chunks.data(), sizeof(LevelChunk), chunks.size()) == chunks.size();
+    if (ok) ok = SDL_RWwrite(rw, grid.cellHead.data(), sizeof(Sint32), grid.cellHead.size()) == grid.cellHead.size();
+    if (ok && !grid.nodeObstacle.empty()) {
+        ok = SDL_RWwrite(rw, grid.nodeObstacle.data(), sizeof(Sint32), grid.nodeObstacle.size()) == grid.nodeObstacle.size() &&
+             SDL_RWwrite(rw, grid.nodeNext.data(), sizeof(Sint32), grid.nodeNext.size()) == grid.nodeNext.size();
+    }
+    SDL_RWclose(rw);
+    return ok;
+}
+
+// ==========================================
+// LEVEL STREAMING
+// ==========================================
+
+// File offset of chunk 'k's first obstacle record
+size_t ChunkRecordsOffset(const ChunkStreamer& streamer, int k) {
+    return sizeof(LevelFileHeader) + (size_t)streamer.chunks[k].firstObstacle * sizeof(Obstacle);
+}
+
+bool ReadChunk(SDL_RWops* rw, const ChunkStreamer& streamer, int k, std::vector<Obstacle>& out) {
+    out.resize(streamer.chunks[k].obstacleCount);
+    if (out.empty()) return true;
+    if (SDL_RWseek(rw, (Sint64)ChunkRecordsOffset(streamer, k), RW_SEEK_SET) < 0) return false;
+    return SDL_RWread(rw, out.data(), sizeof(Obstacle), out.size()) == out.size();
+}
+
+#ifdef UPHILL_THREADS
+void ChunkLoaderMain(ChunkStreamer* streamer) {
+    SDL_RWops* rw = SDL_RWFromFile(streamer->path, "rb");
+    while (true) {
+        int k;
+        {
+            std::unique_lock<std::mutex> guard(streamer->lock);
+            streamer->wake.wait(guard, [&] { return streamer->quit || !streamer->requests.empty(); });
+            if (streamer->quit) break;
+            k = streamer->requests.front();
+            streamer->requests.pop_front();
+        }
+
+        LoadedChunk loaded = { k, {} };
+        if (!rw || !ReadChunk(rw, *streamer, k, loaded.obstacles)) loaded.obstacles.clear();
+
+        std::lock_guard<std::mutex> guard(streamer->lock);
+        streamer->completed.push_back(std::move(loaded));
+    }
+    if (rw) SDL_RWclose(rw);
+}
+#endif
+
+bool ChunkOverlaps(const LevelChunk& chunk, int top, int bottom) {
+    return chunk.obstacleCount > 0 && chunk.top < bottom && chunk.bottom > top;
+}
+
+void MakeChunkResident(ChunkStreamer& streamer, World& level, int k, const std::vector<Obstacle>& obstacles) {
+    std::vector<int>& owned = streamer.slots[k];
+    owned.clear();
+    for (const auto& obs : obstacles) owned.push_back(AddObstacle(level, obs));
+    streamer.state[k] = CHUNK_RESIDENT;
+}
+
+void EvictChunk(ChunkStreamer& streamer, World& level, int k) {
+    for (int index : streamer.slots[k]) RemoveObstacle(level, index);
+    streamer.slots[k].clear();
+    streamer.state[k] = CHUNK_EVICTED;
+}
+
+// Loads chunks right now on the calling thread (startup, or when the view
+// got ahead of the loader - better a hitch than falling through the floor).
+void LoadChunksNow(ChunkStreamer& streamer, World& level, int top, int bottom) {
+    SDL_RWops* rw = nullptr;
+    std::vector<Obstacle> obstacles;
+    for (int k = 0; k < (int)streamer.chunks.size(); k++) {
+        if (streamer.state[k] == CHUNK_RESIDENT || !ChunkOverlaps(streamer.chunks[k], top, bottom)) continue;
+        if (!rw) rw = SDL_RWFromFile(streamer.path, "rb");
+        if (rw && ReadChunk(rw, streamer, k, obstacles)) MakeChunkResident(streamer, level, k, obstacles);
+    }
+    if (rw) SDL_RWclose(rw);
+}
+
+// Opens a chunked level file. 'level' starts with only the chunks around 'view'.
+bool OpenChunkStreamer(ChunkStreamer& streamer, World& level, const char* path, const SDL_Rect& view) {
+    SDL_RWops* rw = SDL_RWFromFile(path, "rb");
+    if (!rw) return false;
+
+    LevelFileHeader& header = streamer.header;
+    bool ok = SDL_RWread(rw, &header, sizeof(header), 1) == 1 &&
+              header.magic == LEVEL_MAGIC && header.version == LEVEL_VERSION && header.chunkCount > 0;
+    if (ok) {
+        streamer.chunks.resize(header.chunkCount);
+        ok = SDL_RWseek(rw, (Sint64)(sizeof(header) + (size_t)header.obstacleCount * sizeof(Obstacle)), RW_SEEK_SET) >= 0 &&
+             SDL_RWread(rw, streamer.chunks.data(), sizeof(LevelChunk), header.chunkCount) == header.chunkCount;
+    }
+    SDL_RWclose(rw);
+    if (!ok) return false;
+
+    SDL_snprintf(streamer.path, sizeof(streamer.path), "%s", path);
+    streamer.state.assign(header.chunkCount, CHUNK_EVICTED);
+    streamer.slots.assign(header.chunkCount, std::vector<int>());
+    streamer.requests.clear();
+    streamer.completed.clear();
+
+    // The grid spans the whole level up front; only its cells fill and empty
+    level.obstacles.clear();
+    level.freeSlots.clear();
+    level.dynamics.clear();
+    level.visuals.clear(); // Chunks arrive one at a time, so nothing is merged
+    level.streaming = true;
+    level.levelId = header.levelId;
+    level.cameraBounds = header.cameraBounds;
+    WarnFixedPointRange(level);
+    ResetSpatialGrid(level.grid, { header.gridOriginX, header.gridOriginY,
+                                   header.gridCols * GRID_CELL_SIZE, header.gridRows * GRID_CELL_SIZE });
+
+    LoadChunksNow(streamer, level, view.y - STREAM_PREFETCH_MARGIN, view.y + view.h + STREAM_PREFETCH_MARGIN);
+
+#ifdef UPHILL_THREADS
+    streamer.quit = false;
+    streamer.loader = std::thread(ChunkLoaderMain, &streamer);
+#endif
+    streamer.open = true;
+    SDL_Log("Level %u: streaming %u chunks from %s", header.levelId, header.chunkCount, path);
+    return true;
+}
+
+void CloseChunkStreamer(ChunkStreamer& streamer) {
+    if (!streamer.open) return;
+#ifdef UPHILL_THREADS
+    {
+        std::lock_guard<std::mutex> guard(streamer.lock);
+        streamer.quit = true;
+    }
+    streamer.wake.notify_all();
+    streamer.loader.join();
+#endif
+    streamer.open = false;
+}
+
+// Once per frame: queue chunks entering the prefetch window, adopt chunks the
+// loader finished, evict chunks far outside the view. The two margins give
+// hysteresis so a player hopping on a chunk border doesn't thrash.
+// Returns true if resident geometry changed.
+bool UpdateChunkStreamer(ChunkStreamer& streamer, World& level, const SDL_Rect& view) {
+    if (!streamer.open) return false;
+
+    int keepTop = view.y - STREAM_PREFETCH_MARGIN, keepBottom = view.y + view.h + STREAM_PREFETCH_MARGIN;
+    int evictTop = view.y - STREAM_EVICT_MARGIN, evictBottom = view.y + view.h + STREAM_EVICT_MARGIN;
+    bool changed = false;
+    bool requested = false;
+
+#ifdef UPHILL_THREADS
+    std::vector<LoadedChunk> finished;
+    {
+        std::lock_guard<std::mutex> guard(streamer.lock);
+        finished.swap(streamer.completed);
+    }
+    for (const auto& loaded : finished) {
+        if (streamer.state[loaded.chunk] != CHUNK_REQUESTED) continue; // Already loaded synchronously
+        if (ChunkOverlaps(streamer.chunks[loaded.chunk], evictTop, evictBottom)) {
+            MakeChunkResident(streamer, level, loaded.chunk, loaded.obstacles);
+            changed = true;
+        } else {
+            streamer.state[loaded.chunk] = CHUNK_EVICTED; // Camera moved on while it was loading
+        }
+    }
+#endif
+
+    for (int k = 0; k < (int)streamer.chunks.size(); k++) {
+        const LevelChunk& chunk = streamer.chunks[k];
+        if (streamer.state[k] == CHUNK_EVICTED && ChunkOverlaps(chunk, keepTop, keepBottom)) {
+            streamer.state[k] = CHUNK_REQUESTED;
+#ifdef UPHILL_THREADS
+            std::lock_guard<std::mutex> guard(streamer.lock);
+            streamer.requests.push_back(k);
+            requested = true;
+#endif
+        } else if (streamer.state[k] == CHUNK_RESIDENT && !ChunkOverlaps(chunk, evictTop, evictBottom)) {
+            EvictChunk(streamer, level, k);
+            changed = true;
+        }
+    }
+
+#ifdef UPHILL_THREADS
+    if (requested) streamer.wake.notify_one();
+    // Whatever is inside the view itself has to be there now
+    for (int k = 0; k < (int)streamer.chunks.size(); k++) {
+        if (streamer.state[k] == CHUNK_REQUESTED && ChunkOverlaps(streamer.chunks[k], view.y, view.y + view.h)) {
+            LoadChunksNow(streamer, level, view.y, view.y + view.h);
+            changed = true;
+            break;
+        }
+    }
+#else
+    // No loader thread: read the requested chunks inline
+    (void)requested;
+    for (int k = 0; k < (int)streamer.chunks.size(); k++) {
+        if (streamer.state[k] != CHUNK_REQUESTED) continue;
+        LoadChunksNow(streamer, level, keepTop, keepBottom);
+        changed = true;
+        break;
+    }
+#endif
+    return changed;
+}
+
+// Synthetic climb for testing big levels: a zig-zag of platforms going up
+// 'screens' screens, with walls split per chunk so they stream too.
+void GenerateClimbLevel(World& level, int screens, Uint32 seed) {
+    Uint32 rng = seed ? seed : 1;
+    auto next = [&rng]() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    std::vector<Obstacle>& obstacles = level.obstacles;
+    obstacles.clear();
+    level.freeSlots.clear();
+    level.streaming = false;
+
+    int top = SCREEN_HEIGHT - screens * SCREEN_HEIGHT;
+    obstacles.push_back({ {0, 600, 1280, 120}, 0 }); // Floor
+    for (int y = top; y < SCREEN_HEIGHT; y += SCREEN_HEIGHT) {
+        obstacles.push_back({ {-50, y, 50, SCREEN_HEIGHT}, 0 });
+        obstacles.push_back({ {1280, y, 50, SCREEN_HEIGHT}, 0 });
+    }
+
+    // Each platform sits beside the one below it, never over it: with only
+    // 80-120 px of clearance the player can't jump up past its underside.
+    // Side gaps stay short enough to jump across from a standing start.
+    const int minGap = 16, maxGap = 96; // px between the platform and the one below, sideways
+    int belowLeft = 0, belowRight = 1280; // Swept x range of the platform below (the floor first)
+    int direction = 1;
+    int count = 0;
+    for (int y = 500; y > top + 100; y -= 100 + (int)(next() % 40)) {
+        int w = 120 + (int)(next() % 160);
+        // Every 5th platform slides and every 7th crumbles
+        int type = ++count % 5 == 0 ? OBSTACLE_MOVING : count % 7 == 0 ? OBSTACLE_CRUMBLING : OBSTACLE_SOLID;
+        int gap = minGap + (int)(next() % (maxGap - minGap + 1));
+        if (next() % 4 == 0) direction = -direction;
+
+        int x;
+        if (count == 1) {
+            x = (int)(next() % (1280 - w - MOVING_TRAVEL)); // Anywhere over the floor
+        } else {
+            auto span = [&] { return w + (type == OBSTACLE_MOVING ? MOVING_TRAVEL : 0); };
+            auto fits = [&](int d) { return d > 0 ? belowRight + gap + span() <= 1280 : belowLeft - gap - span() >= 0; };
+            if (!fits(direction)) direction = -direction;
+            if (!fits(direction)) {
+                // Wide platform below in mid-level: a narrow solid one always fits on one side
+                type = OBSTACLE_SOLID;
+                w = 120;
+                if (!fits(direction)) direction = -direction;
+            }
+            x = direction > 0 ? belowRight + gap : belowLeft - gap - span();
+        }
+        obstacles.push_back({ {x, y, w, 20}, type });
+        belowLeft = x;
+        belowRight = x + w + (type == OBSTACLE_MOVING ? MOVING_TRAVEL : 0);
+    }
+
+    level.cameraBounds = { 0, top, SCREEN_WIDTH, SCREEN_HEIGHT - top };
+    level.levelId = 1000 + (Uint32)screens;
+    WarnFixedPointRange(level);
+    BuildSpatialGrid(level.grid, obstacles);
+    MergeCollisionRects(level);
+    CollectDynamicObstacles(level);
+}
+
+// ==========================================
+// PROFILER
+// ==========================================
+
+#ifdef UPHILL_PROFILE
+#define PROFILE_FRAME_BEGIN() ProfileBeginFrame()
+#define PROFILE_FRAME_END(steps) ProfileEndFrame(steps)
+#define PROFILE_BEGIN(phase) Uint64 profileStart_##phase = SDL_GetPerformanceCounter()
+#define PROFILE_END(phase) ProfileRecord(phase, profileStart_##phase, SDL_GetPerformanceCounter())
+#define PROFILE_OVERLAY() RenderProfileOverlay()
+
+ProfileFrame& CurrentProfileFrame() {
+    return profiler.frames[(profiler.frameCount + PROFILE_FRAME_HISTORY - 1) % PROFILE_FRAME_HISTORY];
+}
+
+void ProfileBeginFrame() {
+    ProfileFrame& frame = profiler.frames[profiler.frameCount % PROFILE_FRAME_HISTORY];
+    frame = {};
+    frame.start = SDL_GetPerformanceCounter();
+    profiler.frameCount++;
+}
+
+void ProfileEndFrame(int steps) {
+    ProfileFrame& frame = CurrentProfileFrame();
+    frame.end = SDL_GetPerformanceCounter();
+    frame.steps = steps;
+}
+
+void ProfileRecord(ProfilePhase phase, Uint64 start, Uint64 end) {
+    profiler.events[profiler.eventCount % PROFILE_EVENT_CAPACITY] = { (Uint8)phase, start, end };
+    profiler.eventCount++;
+    if (profiler.frameCount > 0) CurrentProfileFrame().phaseTicks[phase] += end - start;
+}
+
+double ProfileTicksToMs(Uint64 ticks) {
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// Chrome trace JSON ("X" complete events), viewable in chrome://tracing or Perfetto
+bool SaveProfileTrace(const char* path) {
+    SDL_RWops* rw = SDL_RWFromFile(path, "wb");
+    if (!rw) return false;
+
+    double usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+    Uint32 frameFirst = profiler.frameCount > (Uint32)PROFILE_FRAME_HISTORY ? profiler.frameCount - PROFILE_FRAME_HISTORY : 0;
+    Uint32 eventFirst = profiler.eventCount > (Uint32)PROFILE_EVENT_CAPACITY ? profiler.eventCount - PROFILE_EVENT_CAPACITY : 0;
+    Uint64 epoch = profiler.frames[frameFirst % PROFILE_FRAME_HISTORY].start;
+
+    std::string json = "{\"traceEvents\":[\n";
+    char line[160];
+    bool first = true;
+    auto append = [&](const char* name, Uint64 start, Uint64 end, int tid) {
+        if (start < epoch || end < start) return;
+        SDL_snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     first ? "" : ",\n", name, tid, (start - epoch) * usPerTick, (end - start) * usPerTick);
+        json += line;
+        first = false;
+    };
+    for (Uint32 i = frameFirst; i < profiler.frameCount; i++) {
+        const ProfileFrame& frame = profiler.frames[i % PROFILE_FRAME_HISTORY];
+        append("frame", frame.start, frame.end, 1);
+    }
+    for (Uint32 i = eventFirst; i < profiler.eventCount; i++) {
+        const ProfileEvent& event = profiler.events[i % PROFILE_EVENT_CAPACITY];
+        append(PROFILE_PHASE_NAMES[event.phase], event.start, event.end, 2);
+    }
+    json += "\n]}\n";
+
+    bool ok = SDL_RWwrite(rw, json.data(), 1, json.size()) == json.size();
+    SDL_RWclose(rw);
+    SDL_Log("Profile trace: %u frames to %s %s", profiler.frameCount - frameFirst, path, ok ? "ok" : "failed");
+    return ok;
+}
+
+// 3x5 pixel glyphs for the overlay, one bit per pixel, top row first
+Uint16 ProfileGlyph(char c) {
+    switch (c) {
+        case '0': return 0x7B6F; case '1': return 0x2C97; case '2': return 0x73E7; case '3': return 0x73CF;
+        case '4': return 0x5BC9; case '5': return 0x79CF; case '6': return 0x79EF; case '7': return 0x7249;
+        case '8': return 0x7BEF; case '9': return 0x7BCF; case '.': return 0x0002; case 'p': return 0x7BE4;
+        case 'm': return 0x0FED; case 's': return 0x388E; case 'a': return 0x2BED; case 'x': return 0x5AAD;
+        case 't': return 0x2E93; case 'e': return 0x7BE7;
+        default: return 0;
+    }
+}
+
+void AddProfileText(int x, int y, const char* text, int scale) {
+    for (; *text; text++, x += 4 * scale) {
+        Uint16 glyph = ProfileGlyph(*text);
+        for (int bit = 0; bit < 15; bit++) {
+            if (glyph & (0x4000 >> bit)) profileRects.push_back({ x + (bit % 3) * scale, y + (bit / 3) * scale, scale, scale });
+        }
+    }
+}
+
+// Top-left overlay: stacked per-phase bars for recent frames, a 60 fps
+// guide line, then frame time percentiles and the last frame's step count.
+void RenderProfileOverlay() {
+    if (!profiler.overlay || profiler.frameCount < 2) return;
+
+    const SDL_Color phaseColors[PROFILE_PHASE_COUNT] = {
+        {255, 255, 0, 255}, {0, 255, 255, 255}, {0, 200, 0, 255}, {255, 140, 0, 255}, {255, 0, 255, 255}, {90, 90, 255, 255},
+    };
+    const int barBottom = 110, pxPerMs = 3, left = 10;
+
+    // Completed frames only; the current one is still running
+    float frameMs[PROFILE_FRAME_HISTORY];
+    int count = (int)std::min<Uint32>(profiler.frameCount - 1, PROFILE_FRAME_HISTORY - 1);
+    for (int i = 0; i < count; i++) {
+        const ProfileFrame& frame = profiler.frames[(profiler.frameCount - 1 - count + i) % PROFILE_FRAME_HISTORY];
+        frameMs[i] = (float)ProfileTicksToMs(frame.end - frame.start);
+    }
+
+    SDL_Rect panel = { left - 5, 5, PROFILE_FRAME_HISTORY * 2 + 10, barBottom + 100 };
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &panel);
+
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++) {
+        profileRects.clear();
+        for (int i = 0; i < count; i++) {
+            const ProfileFrame& frame = profiler.frames[(profiler.frameCount - 1 - count + i) % PROFILE_FRAME_HISTORY];
+            int below = 0;
+            for (int p = 0; p < phase; p++) below += (int)(ProfileTicksToMs(frame.phaseTicks[p]) * pxPerMs);
+            int h = (int)(ProfileTicksToMs(frame.phaseTicks[phase]) * pxPerMs);
+            if (h > 0) profileRects.push_back({ left + i * 2, barBottom - below - h, 2, h });
+        }
+        const SDL_Color& c = phaseColors[phase];
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        if (!profileRects.empty()) SDL_RenderFillRects(renderer, profileRects.data(), (int)profileRects.size());
+    }
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 200);
+    SDL_RenderDrawLine(renderer, left, barBottom - (int)(1000.0f / 60 * pxPerMs), left + PROFILE_FRAME_HISTORY * 2, barBottom - (int)(1000.0f / 60 * pxPerMs));
+
+    std::sort(frameMs, frameMs + count);
+    const char* labels[4] = { "p50 ", "p95 ", "p99 ", "max " };
+    const float quantiles[4] = { 0.5f, 0.95f, 0.99f, 1.0f };
+    char text[32];
+    profileRects.clear();
+    for (int i = 0; i < 4; i++) {
+        SDL_snprintf(text, sizeof(text), "%s%.2f ms", labels[i], frameMs[std::min(count - 1, (int)(quantiles[i] * (count - 1)))]);
+        AddProfileText(left, barBottom + 8 + i * 18, text, 3);
+    }
+    const ProfileFrame& last = profiler.frames[(profiler.frameCount - 2) % PROFILE_FRAME_HISTORY];
+    SDL_snprintf(text, sizeof(text), "steps %d", last.steps);
+    AddProfileText(left + 250, barBottom + 8, text, 3);
+    SDL_RenderFillRects(renderer, profileRects.data(), (int)profileRects.size());
+}
+#else
+#define PROFILE_FRAME_BEGIN()
+#define PROFILE_FRAME_END(steps)
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#define PROFILE_OVERLAY()
+#endif
+
+// ==========================================
+// INPUT HANDLING (KEYBOARD + TOUCH)
+// ==========================================
+
+void CreateTileAtlas(); // See RENDERING
+void BakeStaticLayer(const World& level);
+
+// Home slot from the ID, then linear probe (IDs are often small and sequential)
+int FindTouch(const TouchTable& table, SDL_FingerID id) {
+    int home = (int)((Uint64)id % MAX_TOUCHES);
+    for (int i = 0; i < MAX_TOUCHES; i++) {
+        int slot = (home + i) % MAX_TOUCHES;
+        if (table.slots[slot].used && table.slots[slot].id == id) return slot;
+    }
+    return -1;
+}
+
+// Slot for a finger, claiming a free one for new IDs (-1 if the table is full)
+int AcquireTouch(TouchTable& table, SDL_FingerID id) {
+    int slot = FindTouch(table, id);
+    if (slot >= 0) return slot;
+    int home = (int)((Uint64)id % MAX_TOUCHES);
+    for (int i = 0; i < MAX_TOUCHES; i++) {
+        slot = (home + i) % MAX_TOUCHES;
+        if (!table.slots[slot].used) {
+            table.slots[slot] = { id, { 0, 0 }, -1, true };
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// First button under a point, or -1
+int HitTestButtons(float x, float y) {
+    for (int b = 0; b < BUTTON_COUNT; b++) {
+        if (IsPointInRect(x, y, buttons[b].rect)) return b;
+    }
+    return -1;
+}
+
+// Moves a finger's ownership between buttons. Returns true on a fresh press.
+bool SetTouchButton(TouchSlot& touch, int button, Uint32 timestamp) {
+    if (touch.button == button) return false;
+    if (touch.button >= 0) buttons[touch.button].pressCount--;
+    touch.button = button;
+    if (button < 0) return false;
+    buttons[button].pressCount++;
+    buttons[button].lastPressTime = timestamp;
+    return true;
+}
+
+// Keyboard and touch events that change InputState. Everything else is
+// handled as soon as it's polled.
+bool IsGameplayEvent(const SDL_Event& e) {
+    if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+        SDL_Keycode key = e.key.keysym.sym;
+        return key == SDLK_LEFT || key == SDLK_RIGHT || key == SDLK_SPACE;
+    }
+    return e.type == SDL_FINGERDOWN || e.type == SDL_FINGERMOTION || e.type == SDL_FINGERUP;
+}
+
+// SDL event timestamps are in SDL_GetTicks() ms; map them onto the performance counter
+Uint64 EventCounterTime(Uint32 timestamp, Uint64 nowCounter, Uint32 nowTicks, Uint64 counterFreq) {
+    Uint32 age = nowTicks - timestamp;
+    if (age > nowTicks) return nowCounter; // From the future or before the clock started
+    Uint64 ageTicks = (Uint64)age * counterFreq / 1000;
+    return ageTicks < nowCounter ? nowCounter - ageTicks : 0;
+}
+
+void ApplyInputEvent(GameLoop& game, const SDL_Event& e, Uint64 time) {
+    bool pressedJump = false;
+
+    // --- KEYBOARD (PC Testing) ---
+    if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+        bool down = e.type == SDL_KEYDOWN;
+        if (e.key.keysym.sym == SDLK_LEFT) keyLeftHeld = down;
+        if (e.key.keysym.sym == SDLK_RIGHT) keyRightHeld = down;
+        if (e.key.keysym.sym == SDLK_SPACE) {
+            pressedJump = down && !e.key.repeat;
+            keyJumpHeld = down;
+        }
+    }
+    // --- TOUCH (Android) ---
+    // We track fingers manually to support multi-touch (e.g., Run + Jump)
+    else if (e.type == SDL_FINGERDOWN || e.type == SDL_FINGERMOTION) {
+        // Convert normalized (0..1) to Logical (0..1280)
+        float x = e.tfinger.x * SCREEN_WIDTH;
+        float y = e.tfinger.y * SCREEN_HEIGHT;
+        int slot = AcquireTouch(activeFingers, e.tfinger.fingerId);
+        if (slot < 0) return; // More fingers than we track
+        TouchSlot& touch = activeFingers.slots[slot];
+        touch.pos = { x, y };
+        SetTouchButton(touch, HitTestButtons(x, y), e.tfinger.timestamp);
+
+        // Check if this specific touch *just* hit the jump button (Tap event)
+        pressedJump = e.type == SDL_FINGERDOWN && touch.button == BUTTON_JUMP;
+    }
+    else if (e.type == SDL_FINGERUP) {
+        int slot = FindTouch(activeFingers, e.tfinger.fingerId);
+        if (slot >= 0) {
+            SetTouchButton(activeFingers.slots[slot], -1, e.tfinger.timestamp);
+            activeFingers.slots[slot].used = false;
+        }
+    }
+
+    if (pressedJump) {
+        game.input.jumpPressed = true;
+        if (!game.jumpPressTime) game.jumpPressTime = time ? time : 1;
+    }
+
+    // Continuous state: keyboard and touch merged (touch counts are kept up to date above)
+    InputState& input = game.input;
+    input.left = keyLeftHeld || buttons[BUTTON_LEFT].pressCount > 0;
+    input.right = keyRightHeld || buttons[BUTTON_RIGHT].pressCount > 0;
+    input.jumpHeld = keyJumpHeld || buttons[BUTTON_JUMP].pressCount > 0;
+}
+
+// Low-latency mode: apply queued events up to 'time', the end of the step about to run
+void ApplyInputEventsUntil(GameLoop& game, Uint64 time) {
+    InputEventQueue& queue = game.pendingInput;
+    while (queue.count > 0 && queue.times[queue.head] <= time) {
+        ApplyInputEvent(game, queue.events[queue.head], queue.times[queue.head]);
+        queue.head = (queue.head + 1) % INPUT_QUEUE_CAPACITY;
+        queue.count--;
+    }
+}
+
+void HandleInput(GameLoop& game) {
+    // jumpPressed is not reset here: it stays set until a physics step
+    // consumes it, even if this frame runs no step
+    Uint64 nowCounter = SDL_GetPerformanceCounter();
+    Uint32 nowTicks = SDL_GetTicks();
+
+    SDL_Event e;
+    while (SDL_PollEvent(&e) != 0) {
+        if (e.type == SDL_QUIT) {
+            isRunning = false;
+        }
+        // Render targets lose their contents on device/context loss (D3D, Android)
+        else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+            if (e.type == SDL_RENDER_DEVICE_RESET) {
+                CreateTileAtlas(); // All textures are gone
+                if (sceneTarget) SDL_DestroyTexture(sceneTarget);
+                sceneTarget = nullptr;
+                sceneTargetTried = false; // Made again when next needed
+            }
+            BakeStaticLayer(world);
+            game.redraw = true;
+        }
+        else if (e.type == SDL_WINDOWEVENT) {
+            game.redraw = true; // Exposed, resized, restored: the old frame may be gone
+        }
+        else if (IsGameplayEvent(e)) {
+            Uint64 time = EventCounterTime(e.common.timestamp, nowCounter, nowTicks, game.counterFreq);
+            InputEventQueue& queue = game.pendingInput;
+            if (game.lowLatency && queue.count < INPUT_QUEUE_CAPACITY) {
+                int tail = (queue.head + queue.count) % INPUT_QUEUE_CAPACITY;
+                queue.events[tail] = e;
+                queue.times[tail] = time;
+                queue.count++;
+            } else {
+                ApplyInputEventsUntil(game, time); // Keep order if the queue overflowed
+                ApplyInputEvent(game, e, time);
+            }
+        }
+        else if (e.type == SDL_KEYDOWN) {
+            if (e.key.keysym.sym == SDLK_ESCAPE) isRunning = false;
+#ifdef UPHILL_PROFILE
+            if (e.key.keysym.sym == SDLK_F3) {
+                profiler.overlay = !profiler.overlay;
+                game.redraw = true;
+            }
+            if (e.key.keysym.sym == SDLK_F4) SaveProfileTrace(PROFILE_TRACE_FILE);
+#endif
+        }
+    }
+}
+
+// ==========================================
+// PHYSICS
+// ==========================================
+
+// Steps 1-3: input, jumping and gravity. Shared by the scalar and batched paths
+// (the batch uses it for lanes that don't fill a whole SIMD register).
+// Physics is templated on its number type S: float, or Fixed for bit-exact results.
+// Returns true when the player jumps this step.
+template <typename S>
+bool IntegrateVelocity(Vec2T<S>& vel, bool& onGround, int& jumpBuffer, int& coyote, const InputState& input, float dt) {
+    const S step = S(dt);
+    const S zero = S(0);
+
+    // 1. Horizontal
+    S targetSpeed = zero;
+    if (input.left) targetSpeed = S(-MOVE_SPEED);
+    if (input.right) targetSpeed = S(MOVE_SPEED);
+
+    S friction = onGround ? S(FRICTION) : S(AIR_FRICTION);
+
+    if (vel.x < targetSpeed) {
+        vel.x += S(ACCELERATION) * step;
+        if (vel.x > targetSpeed) vel.x = targetSpeed;
+    }
+    else if (vel.x > targetSpeed) {
+        vel.x -= S(ACCELERATION) * step;
+        if (vel.x < targetSpeed) vel.x = targetSpeed;
+    }
+
+    if (targetSpeed == zero) {
+        if (vel.x > zero) {
+            vel.x -= friction * step;
+            if (vel.x < zero) vel.x = zero;
+        } else if (vel.x < zero) {
+            vel.x += friction * step;
+            if (vel.x > zero) vel.x = zero;
+        }
+    }
+
+    // 2. Jumping
+    // Initial Jump. A press shortly before landing (buffer) or shortly
+    // after walking off an edge (coyote time) still counts.
+    bool wantsJump = input.jumpPressed || jumpBuffer > 0;
+    bool canJump = onGround || coyote > 0;
+    bool jumped = wantsJump && canJump;
+    if (jumped) {
+        vel.y = S(JUMP_FORCE);
+        onGround = false;
+        jumpBuffer = 0;
+        coyote = 0;
+    } else if (input.jumpPressed) {
+        jumpBuffer = JUMP_BUFFER_STEPS;
+    } else if (jumpBuffer > 0) {
+        jumpBuffer--;
+    }
+    if (onGround) coyote = COYOTE_STEPS;
+    else if (coyote > 0) coyote--;
+
+    // Variable Jump Height (Celeste Mechanic)
+    // If we release the button while moving up, cut the speed
+    if (!input.jumpHeld && vel.y < zero) {
+        vel.y *= S(0.5f);
+    }
+
+    // 3. Gravity
+    vel.y += S(GRAVITY) * step;
+    if (vel.y > S(MAX_FALL_SPEED)) vel.y = S(MAX_FALL_SPEED);
+    return jumped;
+}
+
+// Grid query rect covering a box and everywhere it moves this step
+template <typename S>
+SDL_Rect SweepBounds(const Vec2T<S>& pos, const Vec2T<S>& size, S dx, S dy) {
+    S x0 = std::min(pos.x, pos.x + dx), y0 = std::min(pos.y, pos.y + dy);
+    S x1 = std::max(pos.x, pos.x + dx) + size.x, y1 = std::max(pos.y, pos.y + dy) + size.y;
+    int left = FloorToInt(x0), top = FloorToInt(y0);
+    return { left, top, CeilToInt(x1) - left, CeilToInt(y1) - top };
+}
+
+// Open-interval overlap, so boxes that only touch don't snag
+template <typename S>
+bool SpansOverlap(S lo, S extent, int otherLo, int otherExtent) {
+    return lo < S(otherLo + otherExtent) && lo + extent > S(otherLo);
+}
+
+// Step 4: movement & collision against the level, plus the respawn check.
+// Swept per axis: each axis moves to the nearest surface in its path instead
+// of testing overlap at the end position, so no speed or step size can
+// tunnel through a platform. Positions never go through int rects.
+// A player standing on a moving obstacle first moves along with it; 'ground'
+// remembers that obstacle, so carrying needs no search.
+// Returns true when the player fell out and respawned.
+template <typename S>
+bool MoveAndCollide(Vec2T<S>& pos, Vec2T<S>& vel, const Vec2T<S>& size, bool& onGround,
+                    int& ground, SDL_Point& groundAt, const World& level, float dt) {
+    const S step = S(dt);
+    const S zero = S(0);
+    const S skin = S(CONTACT_SKIN);
+
+    // Carry
+    if (ground >= 0 && ground < (int)level.obstacles.size()) {
+        const SDL_Rect& r = level.obstacles[ground].rect;
+        int carryX = r.x - groundAt.x, carryY = r.y - groundAt.y;
+        if (IsDynamicObstacle(level.obstacles[ground].type) && std::abs(carryX) <= MAX_CARRY_STEP && std::abs(carryY) <= MAX_CARRY_STEP) {
+            pos.x += S(carryX);
+            pos.y += S(carryY);
+        }
+    }
+
+    // X Axis
+    S dx = vel.x * step;
+    if (dx != zero) {
+        S targetX = pos.x + dx;
+        bool hit = false;
+        QuerySpatialGrid(level.grid, SweepBounds(pos, size, dx, zero), broadphaseHits);
+        for (int i : broadphaseHits) {
+            const SDL_Rect& r = level.obstacles[i].rect;
+            if (!SpansOverlap(pos.y, size.y, r.y, r.h)) continue;
+            if (dx > zero) {
+                S contact = S(r.x) - size.x;
+                if (contact >= pos.x - skin && contact < targetX) { targetX = contact; hit = true; }
+            } else {
+                S contact = S(r.x + r.w);
+                if (contact <= pos.x + skin && contact > targetX) { targetX = contact; hit = true; }
+            }
+        }
+        pos.x = targetX;
+        if (hit) vel.x = zero;
+    }
+
+    // Y Axis
+    S dy = vel.y * step;
+    onGround = false;
+    ground = -1;
+    if (dy != zero) {
+        S targetY = pos.y + dy;
+        bool hit = false;
+        int hitIndex = -1;
+        QuerySpatialGrid(level.grid, SweepBounds(pos, size, zero, dy), broadphaseHits);
+        for (int i : broadphaseHits) {
+            const SDL_Rect& r = level.obstacles[i].rect;
+            if (!SpansOverlap(pos.x, size.x, r.x, r.w)) continue;
+            if (dy > zero) {
+                S contact = S(r.y) - size.y;
+                if (contact >= pos.y - skin && contact < targetY) { targetY = contact; hit = true; hitIndex = i; }
+            } else {
+                S contact = S(r.y + r.h);
+                if (contact <= pos.y + skin && contact > targetY) { targetY = contact; hit = true; }
+            }
+        }
+        pos.y = targetY;
+        if (hit) {
+            onGround = dy > zero;
+            vel.y = zero;
+        }
+        if (onGround) {
+            ground = hitIndex;
+            groundAt = { level.obstacles[hitIndex].rect.x, level.obstacles[hitIndex].rect.y };
+        }
+    }
+
+    // World Bounds
+    if (pos.y > S(SCREEN_HEIGHT + 100)) {
+        pos = { S(100), S(500) };
+        vel = { zero, zero };
+        ground = -1;
+        return true;
+    }
+    return false;
+}
+
+// Returns PHYSICS_EVENT_* bits; callers that only want the new state ignore them.
+template <typename S>
+Uint8 UpdatePhysics(PlayerT<S>& player, const InputState& input, const World& level, float dt) {
+    Uint8 events = 0;
+    if (IntegrateVelocity(player.vel, player.onGround, player.jumpBuffer, player.coyote, input, dt)) events |= PHYSICS_EVENT_JUMP;
+    if (MoveAndCollide(player.pos, player.vel, player.size, player.onGround, player.ground, player.groundAt, level, dt)) events |= PHYSICS_EVENT_RESPAWN;
+    return events;
+}
+
+// Blend two physics states for drawing (alpha 0 = previous, 1 = current).
+// Teleports such as respawning snap instead of sweeping across the screen.
+Player InterpolatePlayer(const Player& previous, const Player& current, float alpha) {
+    Player out = current;
+    Scalar dx = current.pos.x - previous.pos.x;
+    Scalar dy = current.pos.y - previous.pos.y;
+    if (std::fabs(ToFloat(dx)) > INTERPOLATION_SNAP_DISTANCE || std::fabs(ToFloat(dy)) > INTERPOLATION_SNAP_DISTANCE) return out;
+
+    out.pos.x = previous.pos.x + dx * Scalar(alpha);
+    out.pos.y = previous.pos.y + dy * Scalar(alpha);
+    return out;
+}
+
+// ==========================================
+// BATCH SIMULATION (SoA + SIMD)
+// ==========================================
+
+#if defined(UPHILL_SIMD_SSE2) || defined(UPHILL_SIMD_NEON) || defined(UPHILL_SIMD_WASM)
+#define UPHILL_SIMD 1
+
+// Thin wrapper over the three instruction sets; only what the physics needs.
+#if defined(UPHILL_SIMD_SSE2)
+typedef __m128 F4;
+typedef __m128 F4Mask;
+inline F4 F4Load(const float* p) { return _mm_loadu_ps(p); }
+inline void F4Store(float* p, F4 v) { _mm_storeu_ps(p, v); }
+inline F4 F4Set(float v) { return _mm_set1_ps(v); }
+inline F4 F4Add(F4 a, F4 b) { return _mm_add_ps(a, b); }
+inline F4 F4Sub(F4 a, F4 b) { return _mm_sub_ps(a, b); }
+inline F4 F4Mul(F4 a, F4 b) { return _mm_mul_ps(a, b); }
+inline F4 F4Min(F4 a, F4 b) { return _mm_min_ps(a, b); }
+inline F4 F4Max(F4 a, F4 b) { return _mm_max_ps(a, b); }
+inline F4Mask F4Less(F4 a, F4 b) { return _mm_cmplt_ps(a, b); }
+inline F4Mask F4Greater(F4 a, F4 b) { return _mm_cmpgt_ps(a, b); }
+inline F4Mask F4Equal(F4 a, F4 b) { return _mm_cmpeq_ps(a, b); }
+inline F4Mask F4And(F4Mask a, F4Mask b) { return _mm_and_ps(a, b); }
+inline F4Mask F4Or(F4Mask a, F4Mask b) { return _mm_or_ps(a, b); }
+inline F4 F4Select(F4Mask m, F4 a, F4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#elif defined(UPHILL_SIMD_NEON)
+typedef float32x4_t F4;
+typedef uint32x4_t F4Mask;
+inline F4 F4Load(const float* p) { return vld1q_f32(p); }
+inline void F4Store(float* p, F4 v) { vst1q_f32(p, v); }
+inline F4 F4Set(float v) { return vdupq_n_f32(v); }
+inline F4 F4Add(F4 a, F4 b) { return vaddq_f32(a, b); }
+inline F4 F4Sub(F4 a, F4 b) { return vsubq_f32(a, b); }
+inline F4 F4Mul(F4 a, F4 b) { return vmulq_f32(a, b); }
+inline F4 F4Min(F4 a, F4 b) { return vminq_f32(a, b); }
+inline F4 F4Max(F4 a, F4 b) { return vmaxq_f32(a, b); }
+inline F4Mask F4Less(F4 a, F4 b) { return vcltq_f32(a, b); }
+inline F4Mask F4Greater(F4 a, F4 b) { return vcgtq_f32(a, b); }
+inline F4Mask F4Equal(F4 a, F4 b) { return vceqq_f32(a, b); }
+inline F4Mask F4And(F4Mask a, F4Mask b) { return vandq_u32(a, b); }
+inline F4Mask F4Or(F4Mask a, F4Mask b) { return vorrq_u32(a, b); }
+inline F4 F4Select(F4Mask m, F4 a, F4 b) { return vbslq_f32(m, a, b); }
+#else
+typedef v128_t F4;
+typedef v128_t F4Mask;
+inline F4 F4Load(const float* p) { return wasm_v128_load(p); }
+inline void F4Store(float* p, F4 v) { wasm_v128_store(p, v); }
+inline F4 F4Set(float v) { return wasm_f32x4_splat(v); }
+inline F4 F4Add(F4 a, F4 b) { return wasm_f32x4_add(a, b); }
+inline F4 F4Sub(F4 a, F4 b) { return wasm_f32x4_sub(a, b); }
+inline F4 F4Mul(F4 a, F4 b) { return wasm_f32x4_mul(a, b); }
+inline F4 F4Min(F4 a, F4 b) { return wasm_f32x4_pmin(a, b); }
+inline F4 F4Max(F4 a, F4 b) { return wasm_f32x4_pmax(a, b); }
+inline F4Mask F4Less(F4 a, F4 b) { return wasm_f32x4_lt(a, b); }
+inline F4Mask F4Greater(F4 a, F4 b) { return wasm_f32x4_gt(a, b); }
+inline F4Mask F4Equal(F4 a, F4 b) { return wasm_f32x4_eq(a, b); }
+inline F4Mask F4And(F4Mask a, F4Mask b) { return wasm_v128_and(a, b); }
+inline F4Mask F4Or(F4Mask a, F4Mask b) { return wasm_v128_or(a, b); }
+inline F4 F4Select(F4Mask m, F4 a, F4 b) { return wasm_v128_bitselect(a, b, m); }
+#endif
+#endif // SIMD
+
+void ResizePlayerBatch(PlayerBatch& batch, size_t count, const Player& spawn) {
+    batch.size = spawn.size;
+    batch.posX.assign(count, spawn.pos.x);
+    batch.posY.assign(count, spawn.pos.y);
+    batch.velX.assign(count, spawn.vel.x);
+    batch.velY.assign(count, spawn.vel.y);
+    batch.onGround.assign(count, spawn.onGround ? 1.0f : 0.0f);
+    batch.jumpBuffer.assign(count, (float)spawn.jumpBuffer);
+    batch.coyote.assign(count, (float)spawn.coyote);
+    batch.ground.assign(count, spawn.ground);
+    batch.groundAt.assign(count, spawn.groundAt);
+    batch.input.assign(count, InputState());
+    batch.targetSpeed.assign(count, 0.0f);
+    batch.jumpPressed.assign(count, 0.0f);
+    batch.jumpHeld.assign(count, 0.0f);
+}
+
+Player GetBatchPlayer(const PlayerBatch& batch, size_t i) {
+    Player player;
+    player.pos = { batch.posX[i], batch.posY[i] };
+    player.vel = { batch.velX[i], batch.velY[i] };
+    player.size = batch.size;
+    player.onGround = batch.onGround[i] > 0.5f;
+    player.jumpBuffer = (int)batch.jumpBuffer[i];
+    player.coyote = (int)batch.coyote[i];
+    player.ground = batch.ground[i];
+    player.groundAt = batch.groundAt[i];
+    return player;
+}
+
+// Same math as IntegrateVelocity, written branch-free over 4 lanes at a time.
+// Uses the same operations in the same order, so results are bit-identical.
+void IntegrateVelocityBatch(PlayerBatch& batch, float dt, size_t begin, size_t end) {
+    // Bot inputs are effectively random, so build the lanes without branches
+    static const float TARGET_SPEEDS[4] = { 0.0f, -MOVE_SPEED, MOVE_SPEED, MOVE_SPEED }; // Right wins
+    for (size_t i = begin; i < end; i++) {
+        const InputState& in = batch.input[i];
+        batch.targetSpeed[i] = TARGET_SPEEDS[(int)in.left | ((int)in.right << 1)];
+        batch.jumpPressed[i] = (float)in.jumpPressed;
+        batch.jumpHeld[i] = (float)in.jumpHeld;
+    }
+
+    size_t i = begin;
+#if defined(UPHILL_SIMD) && !defined(UPHILL_FIXED_POINT) // Lanes are float; fixed point runs the scalar loop
+    const F4 zero = F4Set(0.0f);
+    const F4 half = F4Set(0.5f);
+    const F4 accelStep = F4Set(ACCELERATION * dt);
+    const F4 groundFriction = F4Set(FRICTION * dt);
+    const F4 airFriction = F4Set(AIR_FRICTION * dt);
+    const F4 gravityStep = F4Set(GRAVITY * dt);
+    const F4 jumpForce = F4Set(JUMP_FORCE);
+    const F4 maxFall = F4Set(MAX_FALL_SPEED);
+    const F4 one = F4Set(1.0f);
+    const F4 bufferSteps = F4Set((float)JUMP_BUFFER_STEPS);
+    const F4 coyoteSteps = F4Set((float)COYOTE_STEPS);
+
+    for (; i + 4 <= end; i += 4) {
+        F4 vx = F4Load(&batch.velX[i]);
+        F4 vy = F4Load(&batch.velY[i]);
+        F4 ground = F4Load(&batch.onGround[i]);
+        F4 target = F4Load(&batch.targetSpeed[i]);
+        F4Mask standing = F4Greater(ground, half);
+
+        // 1. Horizontal: accelerate toward the target speed without overshooting
+        F4 up = F4Min(F4Add(vx, accelStep), target);
+        F4 down = F4Max(F4Sub(vx, accelStep), target);
+        vx = F4Select(F4Less(vx, target), up, F4Select(F4Greater(vx, target), down, vx));
+
+        // Friction only without input, never past zero
+        F4 friction = F4Select(standing, groundFriction, airFriction);
+        F4 slowed = F4Select(F4Greater(vx, zero), F4Max(F4Sub(vx, friction), zero),
+                    F4Select(F4Less(vx, zero), F4Min(F4Add(vx, friction), zero), vx));
+        vx = F4Select(F4Equal(target, zero), slowed, vx);
+
+        // 2. Jumping (with jump buffer and coyote time)
+        F4 buffer = F4Load(&batch.jumpBuffer[i]);
+        F4 coyote = F4Load(&batch.coyote[i]);
+        F4Mask pressed = F4Greater(F4Load(&batch.jumpPressed[i]), half);
+        F4Mask jump = F4And(F4Or(pressed, F4Greater(buffer, zero)), F4Or(standing, F4Greater(coyote, zero)));
+        vy = F4Select(jump, jumpForce, vy);
+        ground = F4Select(jump, zero, ground);
+        buffer = F4Select(jump, zero, F4Select(pressed, bufferSteps, F4Max(F4Sub(buffer, one), zero)));
+        coyote = F4Select(jump, zero, F4Select(standing, coyoteSteps, F4Max(F4Sub(coyote, one), zero)));
+        F4Store(&batch.jumpBuffer[i], buffer);
+        F4Store(&batch.coyote[i], coyote);
+        F4Mask released = F4And(F4Less(F4Load(&batch.jumpHeld[i]), half), F4Less(vy, zero));
+        vy = F4Select(released, F4Mul(vy, half), vy);
+
+        // 3. Gravity
+        vy = F4Min(F4Add(vy, gravityStep), maxFall);
+
+        F4Store(&batch.velX[i], vx);
+        F4Store(&batch.velY[i], vy);
+        F4Store(&batch.onGround[i], ground);
+    }
+#endif
+
+    // Remaining lanes (or everything without SIMD)
+    for (; i < end; i++) {
+        SimVec2 vel = { batch.velX[i], batch.velY[i] };
+        bool ground = batch.onGround[i] > 0.5f;
+        int buffer = (int)batch.jumpBuffer[i], coyote = (int)batch.coyote[i];
+        IntegrateVelocity(vel, ground, buffer, coyote, batch.input[i], dt);
+        batch.velX[i] = vel.x;
+        batch.velY[i] = vel.y;
+        batch.onGround[i] = ground ? 1.0f : 0.0f;
+        batch.jumpBuffer[i] = (float)buffer;
+        batch.coyote[i] = (float)coyote;
+    }
+}
+
+// Advances players [begin, end) by one step. Equivalent to calling
+// UpdatePhysics on each of them, but the velocity update runs 4-wide.
+void UpdatePhysicsBatch(PlayerBatch& batch, const World& level, float dt, size_t begin, size_t end) {
+    IntegrateVelocityBatch(batch, dt, begin, end);
+
+    // Collision is per-player: each one hits a different set of obstacles
+    for (size_t i = begin; i < end; i++) {
+        SimVec2 pos = { batch.posX[i], batch.posY[i] };
+        SimVec2 vel = { batch.velX[i], batch.velY[i] };
+        bool ground = batch.onGround[i] > 0.5f;
+        MoveAndCollide(pos, vel, batch.size, ground, batch.ground[i], batch.groundAt[i], level, dt);
+        batch.posX[i] = pos.x;
+        batch.posY[i] = pos.y;
+        batch.velX[i] = vel.x;
+        batch.velY[i] = vel.y;
+        batch.onGround[i] = ground ? 1.0f : 0.0f;
+    }
+}
+
+void UpdatePhysicsBatch(PlayerBatch& batch, const World& level, float dt) {
+    UpdatePhysicsBatch(batch, level, dt, 0, batch.posX.size());
+}
+
+// ==========================================
+// PARTICLES
+// ==========================================
+
+void InitParticlePool(ParticlePool& pool, int capacity) {
+    capacity = (capacity + 3) & ~3; // Whole SIMD registers, so the update never needs a tail
+    for (auto* lane : { &pool.x, &pool.y, &pool.vx, &pool.vy, &pool.life, &pool.fade, &pool.weight, &pool.size }) {
+        lane->assign((size_t)capacity, 0.0f);
+    }
+    pool.color.assign((size_t)capacity, SDL_Color{ 255, 255, 255, 255 });
+    pool.count = 0;
+    pool.limit = capacity;
+
+    pool.vertices.assign((size_t)capacity * 4, SDL_Vertex());
+    pool.indices.resize((size_t)capacity * 6);
+    for (int i = 0; i < capacity; i++) {
+        int* quad = &pool.indices[(size_t)i * 6];
+        int v = i * 4;
+        quad[0] = v; quad[1] = v + 1; quad[2] = v + 2;
+        quad[3] = v + 2; quad[4] = v + 3; quad[5] = v;
+    }
+}
+
+// Uniform random number in [lo, hi). Effects only, so it needn't match across platforms.
+float ParticleRandom(ParticlePool& pool, float lo, float hi) {
+    Uint32& r = pool.rng;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    return lo + (hi - lo) * (float)(r >> 8) * (1.0f / 16777216.0f);
+}
+
+void EmitParticle(ParticlePool& pool, float x, float y, float vx, float vy, float lifetime, float weight, float size, SDL_Color color) {
+    if (pool.count >= pool.limit) return; // Full: effects degrade, frame time doesn't
+    int i = pool.count++;
+    pool.x[i] = x;
+    pool.y[i] = y;
+    pool.vx[i] = vx;
+    pool.vy[i] = vy;
+    pool.life[i] = lifetime;
+    pool.fade[i] = 1.0f / lifetime;
+    pool.weight[i] = weight;
+    pool.size[i] = size;
+    pool.color[i] = color;
+}
+
+// Dust puffs sideways from the feet, more for harder landings
+void EmitLandingDust(ParticlePool& pool, const Player& player, float impactSpeed) {
+    float footX = ToFloat(player.pos.x) + ToFloat(player.size.x) * 0.5f;
+    float footY = ToFloat(player.pos.y) + ToFloat(player.size.y);
+    int count = (int)(LANDING_DUST_MAX * std::clamp(impactSpeed / MAX_FALL_SPEED, 0.2f, 1.0f));
+    for (int i = 0; i < count; i++) {
+        float side = (i & 1) ? 1.0f : -1.0f;
+        EmitParticle(pool, footX + ParticleRandom(pool, -8, 8), footY - 2,
+                     side * ParticleRandom(pool, 40, 160), ParticleRandom(pool, -120, -20),
+                     ParticleRandom(pool, 0.3f, 0.6f), 0.5f, ParticleRandom(pool, 2, 5), SDL_Color{ 200, 180, 150, 200 });
+    }
+}
+
+void EmitJumpTrail(ParticlePool& pool, const Player& player) {
+    float footX = ToFloat(player.pos.x) + ToFloat(player.size.x) * 0.5f;
+    float footY = ToFloat(player.pos.y) + ToFloat(player.size.y);
+    for (int i = 0; i < JUMP_TRAIL_PER_FRAME; i++) {
+        EmitParticle(pool, footX + ParticleRandom(pool, -6, 6), footY, ParticleRandom(pool, -20, 20), ParticleRandom(pool, 0, 30),
+                     ParticleRandom(pool, 0.2f, 0.4f), 0.0f, ParticleRandom(pool, 2, 4), SDL_Color{ 255, 140, 60, 160 });
+    }
+}
+
+// Snow spawned along the top edge of the view, enough to cross it before fading
+void EmitWeather(ParticlePool& pool, const SDL_Rect& view, float dt) {
+    pool.weatherDebt += WEATHER_RATE * dt;
+    for (; pool.weatherDebt >= 1.0f; pool.weatherDebt -= 1.0f) {
+        EmitParticle(pool, view.x + ParticleRandom(pool, -100, (float)view.w + 100), view.y - 10.0f,
+                     ParticleRandom(pool, -30, 10), ParticleRandom(pool, 60, 120),
+                     view.h / 60.0f, 0.0f, ParticleRandom(pool, 2, 4), SDL_Color{ 255, 255, 255, 220 });
+    }
+}
+
+// Moves every live particle, 4 at a time where SIMD is available, then packs
+// the survivors to the front of the pool.
+void UpdateParticles(ParticlePool& pool, float dt) {
+    dt = std::min(dt, PARTICLE_MAX_FRAME_TIME);
+    int i = 0;
+#ifdef UPHILL_SIMD
+    const F4 step = F4Set(dt);
+    const F4 gravityStep = F4Set(PARTICLE_GRAVITY * dt);
+    for (; i < pool.count; i += 4) { // The capacity is a multiple of 4; stale lanes past 'count' are harmless
+        F4 vy = F4Load(&pool.vy[i]);
+        F4Store(&pool.x[i], F4Add(F4Load(&pool.x[i]), F4Mul(F4Load(&pool.vx[i]), step)));
+        F4Store(&pool.y[i], F4Add(F4Load(&pool.y[i]), F4Mul(vy, step)));
+        F4Store(&pool.vy[i], F4Add(vy, F4Mul(F4Load(&pool.weight[i]), gravityStep)));
+        F4Store(&pool.life[i], F4Sub(F4Load(&pool.life[i]), step));
+    }
+#else
+    for (; i < pool.count; i++) {
+        pool.x[i] += pool.vx[i] * dt;
+        pool.y[i] += pool.vy[i] * dt;
+        pool.vy[i] += pool.weight[i] * PARTICLE_GRAVITY * dt;
+        pool.life[i] -= dt;
+    }
+#endif
+
+    for (int k = 0; k < pool.count;) {
+        if (pool.life[k] > 0) {
+            k++;
+            continue;
+        }
+        int last = --pool.count;
+        pool.x[k] = pool.x[last];
+        pool.y[k] = pool.y[last];
+        pool.vx[k] = pool.vx[last];
+        pool.vy[k] = pool.vy[last];
+        pool.life[k] = pool.life[last];
+        pool.fade[k] = pool.fade[last];
+        pool.weight[k] = pool.weight[last];
+        pool.size[k] = pool.size[last];
+        pool.color[k] = pool.color[last];
+    }
+}
+
+// Every visible particle as one untextured quad, submitted in a single call
+void RenderParticles(ParticlePool& pool, const SDL_Rect& view) {
+    int quads = 0;
+    for (int i = 0; i < pool.count; i++) {
+        float s = pool.size[i];
+        float px = pool.x[i] - view.x, py = pool.y[i] - view.y;
+        if (px + s < 0 || py + s < 0 || px > view.w || py > view.h) continue;
+
+        SDL_Color c = pool.color[i];
+        c.a = (Uint8)(c.a * std::min(1.0f, pool.life[i] * pool.fade[i] * 2.0f)); // Fade over the last half
+        SDL_Vertex* v = &pool.vertices[(size_t)quads * 4];
+        v[0] = { { px, py }, c, { 0, 0 } };
+        v[1] = { { px + s, py }, c, { 0, 0 } };
+        v[2] = { { px + s, py + s }, c, { 0, 0 } };
+        v[3] = { { px, py + s }, c, { 0, 0 } };
+        quads++;
+    }
+    if (quads == 0) return;
+    SDL_RenderGeometry(renderer, nullptr, pool.vertices.data(), quads * 4, pool.indices.data(), quads * 6);
+}
+
+// ==========================================
+// JOB SYSTEM
+// ==========================================
+
+void RunJob(JobSystem& jobs, const Job& job) {
+    job.run(job.context, job.begin, job.end);
+    jobs.jobsRun.fetch_add(1, std::memory_order_relaxed);
+    jobs.itemsRun.fetch_add(job.end - job.begin, std::memory_order_relaxed);
+    job.remaining->fetch_sub(1, std::memory_order_release);
+}
+
+#ifdef UPHILL_THREADS
+// Own queue first (newest job, still warm in cache), then steal the oldest
+// job of another thread.
+bool FindJob(JobSystem& jobs, int self, Job& out) {
+    int queueCount = (int)jobs.queues.size();
+    for (int k = 0; k < queueCount; k++) {
+        int index = (self + k) % queueCount;
+        JobQueue& queue = *jobs.queues[index];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) continue;
+
+        if (k == 0) {
+            out = queue.jobs.back();
+            queue.jobs.pop_back();
+        } else {
+            out = queue.jobs.front();
+            queue.jobs.pop_front();
+            jobs.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+        }
+        jobs.queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void WorkerMain(JobSystem* jobs, int index) {
+    Job job;
+    while (true) {
+        if (FindJob(*jobs, index, job)) {
+            RunJob(*jobs, job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> sleep(jobs->sleepLock);
+        jobs->wake.wait(sleep, [&] { return jobs->quit.load() || jobs->queued.load() > 0; });
+        if (jobs->quit.load() && jobs->queued.load() == 0) return;
+    }
+}
+#endif
+
+// workers = extra threads besides the caller; < 0 means one per remaining core.
+void StartJobSystem(JobSystem& jobs, int workers) {
+#ifdef UPHILL_THREADS
+    if (workers < 0) workers = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+    jobs.workerCount = workers;
+    jobs.quit = false;
+    jobs.queues.clear();
+    for (int i = 0; i <= workers; i++) jobs.queues.push_back(std::make_unique<JobQueue>());
+    for (int i = 0; i < workers; i++) jobs.threads.emplace_back(WorkerMain, &jobs, i);
+#else
+    (void)workers;
+    jobs.workerCount = 0;
+#endif
+}
+
+void StopJobSystem(JobSystem& jobs) {
+#ifdef UPHILL_THREADS
+    {
+        std::lock_guard<std::mutex> guard(jobs.sleepLock);
+        jobs.quit = true;
+    }
+    jobs.wake.notify_all();
+    for (auto& thread : jobs.threads) thread.join();
+    jobs.threads.clear();
+#endif
+    jobs.workerCount = 0;
+}
+
+// Splits [0, count) into slices of 'grain' items, spreads them over all
+// queues and helps out until every slice is done. Idle threads steal, so
+// uneven slices (players stuck in busy areas) still balance out.
+void ParallelFor(JobSystem& jobs, size_t count, size_t grain, void (*run)(void*, size_t, size_t), void* context) {
+    grain = std::max<size_t>(grain, 1);
+    std::atomic<int> remaining{0};
+
+#ifdef UPHILL_THREADS
+    if (jobs.workerCount > 0 && count > grain) {
+        int queueCount = (int)jobs.queues.size();
+        int sliceCount = (int)((count + grain - 1) / grain);
+        remaining = sliceCount;
+
+        for (int slice = 0; slice < sliceCount; slice++) {
+            size_t begin = (size_t)slice * grain;
+            Job job = { run, context, begin, std::min(begin + grain, count), &remaining };
+            JobQueue& queue = *jobs.queues[slice % queueCount];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.jobs.push_back(job);
+        }
+        jobs.queued.fetch_add(sliceCount);
+        {
+            std::lock_guard<std::mutex> guard(jobs.sleepLock); // Don't let a worker miss the wakeup
+        }
+        jobs.wake.notify_all();
+
+        Job job;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (FindJob(jobs, jobs.workerCount, job)) RunJob(jobs, job);
+            else std::this_thread::yield();
+        }
+        return;
+    }
+#endif
+
+    remaining = 1;
+    RunJob(jobs, { run, context, 0, count, &remaining });
+}
+
+// Lanes per job. The lane vectors use the default allocator (no 64-byte
+// alignment), so neighbouring jobs can share the cache line at a slice edge;
+// with 256 lanes that false sharing is at most one line per array per edge.
+const size_t BATCH_JOB_GRAIN = 256;
+
+struct BatchStepJob {
+    PlayerBatch* batch;
+    const World* level;
+    float dt;
+};
+
+void RunBatchStepJob(void* context, size_t begin, size_t end) {
+    BatchStepJob& job = *(BatchStepJob*)context;
+    UpdatePhysicsBatch(*job.batch, *job.level, job.dt, begin, end);
+}
+
+// One step for the whole batch, split across the job system. The level is
+// only read, so every thread shares it.
+void UpdatePhysicsBatchParallel(JobSystem& jobs, PlayerBatch& batch, const World& level, float dt) {
+    BatchStepJob job = { &batch, &level, dt };
+    ParallelFor(jobs, batch.posX.size(), BATCH_JOB_GRAIN, RunBatchStepJob, &job);
+}
+
+// ==========================================
+// CAMERA
+// ==========================================
+
+// Clamp one axis of the view into [min, min + size]; center levels smaller than the view.
+float ClampCameraAxis(float target, int min, int size, int view) {
+    if (size <= view) return min + (size - view) * 0.5f;
+    return std::clamp(target, (float)min, (float)(min + size - view));
+}
+
+void UpdateCamera(Camera& cam, const Player& player) {
+    float targetX = ToFloat(player.pos.x) + ToFloat(player.size.x) * 0.5f - SCREEN_WIDTH * 0.5f;
+    float targetY = ToFloat(player.pos.y) + ToFloat(player.size.y) * 0.5f - SCREEN_HEIGHT * CAMERA_FOCUS_Y;
+    cam.x = ClampCameraAxis(targetX, cam.bounds.x, cam.bounds.w, SCREEN_WIDTH);
+    cam.y = ClampCameraAxis(targetY, cam.bounds.y, cam.bounds.h, SCREEN_HEIGHT);
+}
+
+// World rect covered by the camera, snapped to whole pixels so tiles don't shimmer.
+SDL_Rect CameraView(const Camera& cam) {
+    return { (int)std::lround(cam.x), (int)std::lround(cam.y), SCREEN_WIDTH, SCREEN_HEIGHT };
+}
+
+// ==========================================
+// RENDERING
+// ==========================================
+
+void RenderButton(const TouchButton& btn) {
+    // Draw Outline
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 150);
+    SDL_RenderDrawRect(renderer, &btn.rect);
+
+    // Draw Fill (Visual feedback when pressed)
+    if (btn.pressCount > 0) {
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 100);
+        SDL_RenderFillRect(renderer, &btn.rect);
+    }
+}
+
+// Obstacles are grouped by style and each group is submitted with one fill
+// and one outline call, instead of four calls per obstacle.
+void ClearObstacleBatches() {
+    for (auto& batch : obstacleBatches) batch.clear();
+}
+
+void AddToObstacleBatch(const Obstacle& obs, int offsetX, int offsetY) {
+    int style = std::clamp(obs.type, 0, OBSTACLE_STYLE_COUNT - 1);
+    obstacleBatches[style].push_back({ obs.rect.x + offsetX, obs.rect.y + offsetY, obs.rect.w, obs.rect.h });
+}
+
+void SubmitObstacleBatches() {
+    for (int style = 0; style < OBSTACLE_STYLE_COUNT; style++) {
+        const auto& batch = obstacleBatches[style];
+        if (batch.empty()) continue;
+
+        const SDL_Color& fill = OBSTACLE_STYLES[style].fill;
+        const SDL_Color& border = OBSTACLE_STYLES[style].border;
+        SDL_SetRenderDrawColor(renderer, fill.r, fill.g, fill.b, fill.a);
+        SDL_RenderFillRects(renderer, batch.data(), (int)batch.size());
+        SDL_SetRenderDrawColor(renderer, border.r, border.g, border.b, border.a);
+        SDL_RenderDrawRects(renderer, batch.data(), (int)batch.size());
+    }
+}
+
+// Builds the atlas: TILE_ATLAS_FILE if it has the expected size, otherwise
+// flat tiles in the OBSTACLE_STYLES colors (so nothing changes until there's art).
+void CreateTileAtlas() {
+    if (tileAtlas) {
+        SDL_DestroyTexture(tileAtlas);
+        tileAtlas = nullptr;
+    }
+    int width = (OBSTACLE_STYLE_COUNT + 1) * TILE_BLOCK_SIZE;
+    int height = TILE_BLOCK_SIZE;
+
+    SDL_Surface* surface = SDL_LoadBMP(TILE_ATLAS_FILE);
+    if (surface && (surface->w != width || surface->h != height)) {
+        SDL_Log("%s is %dx%d, expected %dx%d; using generated tiles", TILE_ATLAS_FILE, surface->w, surface->h, width, height);
+        SDL_FreeSurface(surface);
+        surface = nullptr;
+    }
+    if (!surface) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!surface) return;
+        for (int block = 0; block <= OBSTACLE_STYLE_COUNT; block++) {
+            const ObstacleStyle& style = block < OBSTACLE_STYLE_COUNT ? OBSTACLE_STYLES[block] : PLAYER_STYLE;
+            SDL_Rect outer = { block * TILE_BLOCK_SIZE, 0, TILE_BLOCK_SIZE, TILE_BLOCK_SIZE };
+            SDL_Rect inner = { outer.x + TILE_BORDER, TILE_BORDER, TILE_BLOCK_SIZE - 2 * TILE_BORDER, TILE_BLOCK_SIZE - 2 * TILE_BORDER };
+            SDL_FillRect(surface, &outer, SDL_MapRGBA(surface->format, style.border.r, style.border.g, style.border.b, style.border.a));
+            SDL_FillRect(surface, &inner, SDL_MapRGBA(surface->format, style.fill.r, style.fill.g, style.fill.b, style.fill.a));
+        }
+    }
+
+    tileAtlas = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    tileAtlasWidth = width;
+    tileAtlasHeight = height;
+}
+
+void ClearTileBatch(TileBatch& batch) {
+    batch.vertices.clear();
+    batch.indices.clear();
+}
+
+// Screen quad (x, y, w, h) textured with atlas pixels (u, v, w, h)
+void AddTileQuad(TileBatch& batch, float x, float y, float w, float h, float u, float v, float uw, float vh) {
+    const SDL_Color white = { 255, 255, 255, 255 };
+    float u0 = u / tileAtlasWidth, v0 = v / tileAtlasHeight;
+    float u1 = (u + uw) / tileAtlasWidth, v1 = (v + vh) / tileAtlasHeight;
+
+    int base = (int)batch.vertices.size();
+    batch.vertices.push_back({ { x, y }, white, { u0, v0 } });
+    batch.vertices.push_back({ { x + w, y }, white, { u1, v0 } });
+    batch.vertices.push_back({ { x + w, y + h }, white, { u1, v1 } });
+    batch.vertices.push_back({ { x, y + h }, white, { u0, v1 } });
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int i : quad) batch.indices.push_back(base + i);
+}
+
+// Which of the 3 tiles along one axis to use for tile 'i' of 'count'.
+// A lone tile takes the first one, so thin platforms keep their top edge.
+int TilePiece(int i, int count) {
+    if (i == 0) return 0;
+    return i == count - 1 ? 2 : 1;
+}
+
+// Covers an obstacle with TILE_SIZE tiles, skipping those outside 'clip'.
+// A partial last tile shows the far end of its atlas tile so the border stays.
+void AddObstacleTiles(TileBatch& batch, const Obstacle& obs, const SDL_Rect& clip, int offsetX, int offsetY) {
+    const SDL_Rect& r = obs.rect;
+    int style = std::clamp(obs.type, 0, OBSTACLE_STYLE_COUNT - 1);
+    int cols = (r.w + TILE_SIZE - 1) / TILE_SIZE;
+    int rows = (r.h + TILE_SIZE - 1) / TILE_SIZE;
+
+    int firstCol = std::max(0, (clip.x - r.x) / TILE_SIZE), lastCol = std::min(cols - 1, (clip.x + clip.w - r.x) / TILE_SIZE);
+    int firstRow = std::max(0, (clip.y - r.y) / TILE_SIZE), lastRow = std::min(rows - 1, (clip.y + clip.h - r.y) / TILE_SIZE);
+    for (int row = firstRow; row <= lastRow; row++) {
+        int h = std::min(TILE_SIZE, r.h - row * TILE_SIZE);
+        int pieceY = TilePiece(row, rows);
+        float v = (float)(pieceY * TILE_SIZE + (pieceY == 2 ? TILE_SIZE - h : 0));
+        for (int col = firstCol; col <= lastCol; col++) {
+            int w = std::min(TILE_SIZE, r.w - col * TILE_SIZE);
+            int pieceX = TilePiece(col, cols);
+            float u = (float)(style * TILE_BLOCK_SIZE + pieceX * TILE_SIZE + (pieceX == 2 ? TILE_SIZE - w : 0));
+            AddTileQuad(batch, (float)(r.x + col * TILE_SIZE + offsetX), (float)(r.y + row * TILE_SIZE + offsetY),
+                        (float)w, (float)h, u, v, (float)w, (float)h);
+        }
+    }
+}
+
+void SubmitTileBatch(const TileBatch& batch) {
+    if (batch.indices.empty()) return;
+    SDL_RenderGeometry(renderer, tileAtlas, batch.vertices.data(), (int)batch.vertices.size(),
+                       batch.indices.data(), (int)batch.indices.size());
+}
+
+// Renders the whole level into a target texture once, so each frame is a
+// single copy. Falls back to per-frame batches if the renderer can't do it.
+// Dynamic obstacles are left out; Render draws them every frame.
+void BakeStaticLayer(const World& level) {
+    if (staticLayer) {
+        SDL_DestroyTexture(staticLayer);
+        staticLayer = nullptr;
+    }
+    // A streamed level changes under the camera; draw it culled instead
+    if (!BAKE_STATIC_LAYER || !renderer || level.obstacles.empty() || level.streaming) return;
+
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0 || !(info.flags & SDL_RENDERER_TARGETTEXTURE)) return;
+
+    const std::vector<Obstacle>& authored = AuthoredObstacles(level);
+    SDL_Rect bounds = ComputeLevelBounds(authored);
+    if (bounds.w <= 0 || bounds.h <= 0) return;
+    if ((long long)bounds.w * bounds.h > STATIC_LAYER_MAX_PIXELS) return;
+    if ((info.max_texture_width > 0 && bounds.w > info.max_texture_width) ||
+        (info.max_texture_height > 0 && bounds.h > info.max_texture_height)) return;
+
+    SDL_Texture* layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, bounds.w, bounds.h);
+    if (!layer) return;
+    SDL_SetTextureBlendMode(layer, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+    if (SDL_SetRenderTarget(renderer, layer) != 0) {
+        SDL_DestroyTexture(layer);
+        return;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0); // Transparent, sky shows through
+    SDL_RenderClear(renderer);
+    if (tileAtlas) {
+        ClearTileBatch(levelTiles);
+        for (const auto& obs : authored) {
+            if (obs.type != OBSTACLE_FREE && !IsDynamicObstacle(obs.type)) AddObstacleTiles(levelTiles, obs, obs.rect, -bounds.x, -bounds.y);
+        }
+        SubmitTileBatch(levelTiles);
+    } else {
+        ClearObstacleBatches();
+        for (const auto& obs : authored) {
+            if (obs.type != OBSTACLE_FREE && !IsDynamicObstacle(obs.type)) AddToObstacleBatch(obs, -bounds.x, -bounds.y);
+        }
+        SubmitObstacleBatches();
+    }
+    SDL_SetRenderTarget(renderer, previousTarget);
+
+    staticLayer = layer;
+    staticLayerBounds = bounds;
+}
+
+// 'alpha' blends dynamic obstacles between their last two poses, like the player.
+void Render(const World& level, const Player& player, const Camera& cam, float alpha) {
+    SDL_SetRenderDrawColor(renderer, 135, 206, 235, 255); // Sky Blue
+    SDL_RenderClear(renderer);
+
+    SDL_Rect view = CameraView(cam);
+
+    // Obstacles (only the part inside the view is submitted)
+    if (staticLayer) {
+        SDL_Rect visible;
+        if (SDL_IntersectRect(&view, &staticLayerBounds, &visible)) {
+            SDL_Rect src = { visible.x - staticLayerBounds.x, visible.y - staticLayerBounds.y, visible.w, visible.h };
+            SDL_Rect dst = { visible.x - view.x, visible.y - view.y, visible.w, visible.h };
+            SDL_RenderCopy(renderer, staticLayer, &src, &dst);
+        }
+    } else if (tileAtlas) {
+        // One vertex batch for every visible tile
+        QuerySpatialGrid(AuthoredGrid(level), view, visibleObstacles);
+        ClearTileBatch(levelTiles);
+        for (int i : visibleObstacles) {
+            const Obstacle& obs = AuthoredObstacles(level)[i];
+            if (!IsDynamicObstacle(obs.type) && CheckCollision(view, obs.rect)) AddObstacleTiles(levelTiles, obs, view, -view.x, -view.y);
+        }
+        SubmitTileBatch(levelTiles);
+    } else {
+        QuerySpatialGrid(AuthoredGrid(level), view, visibleObstacles);
+        ClearObstacleBatches();
+        for (int i : visibleObstacles) {
+            const Obstacle& obs = AuthoredObstacles(level)[i];
+            if (!IsDynamicObstacle(obs.type) && CheckCollision(view, obs.rect)) AddToObstacleBatch(obs, -view.x, -view.y);
+        }
+        SubmitObstacleBatches();
+    }
+
+    // Dynamic obstacles
+    if (!level.dynamics.empty()) {
+        if (tileAtlas) ClearTileBatch(levelTiles);
+        else ClearObstacleBatches();
+        for (const DynamicObstacle& d : level.dynamics) {
+            if (!d.solid) continue;
+            Obstacle obs = level.obstacles[d.index];
+            obs.rect.x = (int)(d.previous.x + (obs.rect.x - d.previous.x) * alpha);
+            obs.rect.y = (int)(d.previous.y + (obs.rect.y - d.previous.y) * alpha);
+            if (!CheckCollision(view, obs.rect)) continue;
+            if (tileAtlas) AddObstacleTiles(levelTiles, obs, view, -view.x, -view.y);
+            else AddToObstacleBatch(obs, -view.x, -view.y);
+        }
+        if (tileAtlas) SubmitTileBatch(levelTiles);
+        else SubmitObstacleBatches();
+    }
+
+    RenderParticles(particles, view);
+
+    // Player
+    SDL_Rect pRect = { (int)ToFloat(player.pos.x) - view.x, (int)ToFloat(player.pos.y) - view.y,
+                       (int)ToFloat(player.size.x), (int)ToFloat(player.size.y) };
+    if (tileAtlas) {
+        ClearTileBatch(actorTiles);
+        AddTileQuad(actorTiles, (float)pRect.x, (float)pRect.y, (float)pRect.w, (float)pRect.h,
+                    (float)(OBSTACLE_STYLE_COUNT * TILE_BLOCK_SIZE), 0, (float)TILE_BLOCK_SIZE, (float)TILE_BLOCK_SIZE);
+        SubmitTileBatch(actorTiles);
+    } else {
+        SDL_SetRenderDrawColor(renderer, 255, 69, 0, 255); // Red-Orange
+        SDL_RenderFillRect(renderer, &pRect);
+    }
+}
+
+// UI (On-Screen Controls), always at full resolution
+void RenderControls() {
+    for (const TouchButton& btn : buttons) RenderButton(btn);
+}
+
+// The scene target is only made once the quality first drops below full
+// scale; most sessions never need it, so startup doesn't pay for it.
+SDL_Texture* GetSceneTarget() {
+    if (sceneTargetTried) return sceneTarget;
+    sceneTargetTried = true;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_TARGETTEXTURE)) {
+        sceneTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+        if (sceneTarget) SDL_SetTextureScaleMode(sceneTarget, SDL_ScaleModeLinear);
+    }
+    return sceneTarget;
+}
+
+// Dynamic resolution: below full scale the world is drawn into the top-left
+// part of 'sceneTarget' and stretched over the screen by EndScene. Returns
+// false (draw straight to the screen) at full scale or without target support.
+bool BeginScene(float scale) {
+    if (scale >= 1.0f || !GetSceneTarget() || SDL_SetRenderTarget(renderer, sceneTarget) != 0) return false;
+    SDL_RenderSetScale(renderer, scale, scale);
+    return true;
+}
+
+void EndScene(float scale) {
+    SDL_SetRenderTarget(renderer, nullptr); // Restores the screen's logical size and scale
+    SDL_Rect src = { 0, 0, (int)(SCREEN_WIDTH * scale), (int)(SCREEN_HEIGHT * scale) };
+    SDL_RenderCopy(renderer, sceneTarget, &src, nullptr);
+}
+
+// ==========================================
+// REPLAYS
+// ==========================================
+// File layout (little-endian):
+//   u32 magic "UPRP", u8 version, u16 physics Hz, u8 numeric mode (0 float, 1 fixed),
+//   u32 level id, u32 seed, u32 steps
+//   run*: u8 (state | length << 4); length 1-15 inline, 0 = LEB128 length follows
+
+Uint8 PackInput(const InputState& input) {
+    return (Uint8)((input.left ? 1 : 0) | (input.right ? 2 : 0) |
+                   (input.jumpPressed ? 4 : 0) | (input.jumpHeld ? 8 : 0));
+}
+
+InputState UnpackInput(Uint8 bits) {
+    InputState input;
+    input.left = (bits & 1) != 0;
+    input.right = (bits & 2) != 0;
+    input.jumpPressed = (bits & 4) != 0;
+    input.jumpHeld = (bits & 8) != 0;
+    return input;
+}
+
+void AppendU32(std::vector<Uint8>& out, Uint32 v) {
+    for (int i = 0; i < 4; i++) out.push_back((Uint8)(v >> (i * 8)));
+}
+
+void AppendVarint(std::vector<Uint8>& out, Uint32 v) {
+    while (v >= 0x80) {
+        out.push_back((Uint8)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((Uint8)v);
+}
+
+bool ReadU32(const Uint8* data, size_t size, size_t& offset, Uint32& out) {
+    if (offset + 4 > size) return false;
+    out = (Uint32)data[offset] | ((Uint32)data[offset + 1] << 8) |
+          ((Uint32)data[offset + 2] << 16) | ((Uint32)data[offset + 3] << 24);
+    offset += 4;
+    return true;
+}
+
+bool ReadVarint(const Uint8* data, size_t size, size_t& offset, Uint32& out) {
+    out = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (offset >= size) return false;
+        Uint8 b = data[offset++];
+        out |= (Uint32)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+void EncodeReplayRun(std::vector<Uint8>& out, Uint8 state, Uint32 length) {
+    if (length <= 15) {
+        out.push_back((Uint8)(state | (length << 4)));
+    } else {
+        out.push_back(state);
+        AppendVarint(out, length);
+    }
+}
+
+void StartReplayRecording(ReplayRecorder& rec, Uint32 levelId, Uint32 seed) {
+    rec.header = ReplayHeader();
+    rec.header.levelId = levelId;
+    rec.header.seed = seed;
+    rec.runs.clear();
+    rec.runs.reserve(REPLAY_RESERVE_BYTES);
+    rec.runLength = 0;
+}
+
+// Call once per physics step with exactly the input UpdatePhysics saw.
+void RecordReplayStep(ReplayRecorder& rec, const InputState& input) {
+    Uint8 state = PackInput(input);
+    if (rec.runLength > 0 && (state != rec.runState || rec.runLength == 0xFFFFFFFFu)) {
+        EncodeReplayRun(rec.runs, rec.runState, rec.runLength);
+        rec.runLength = 0;
+    }
+    rec.runState = state;
+    rec.runLength++;
+    rec.header.steps++;
+}
+
+bool SaveReplay(const ReplayRecorder& rec, const char* path) {
+    std::vector<Uint8> file;
+    AppendU32(file, REPLAY_MAGIC);
+    file.push_back(REPLAY_VERSION);
+    file.push_back((Uint8)(rec.header.physicsHz & 0xFF));
+    file.push_back((Uint8)(rec.header.physicsHz >> 8));
+    file.push_back(rec.header.numeric);
+    AppendU32(file, rec.header.levelId);
+    AppendU32(file, rec.header.seed);
+    AppendU32(file, rec.header.steps);
+    file.insert(file.end(), rec.runs.begin(), rec.runs.end());
+    if (rec.runLength > 0) EncodeReplayRun(file, rec.runState, rec.runLength);
+
+    SDL_RWops* rw = SDL_RWFromFile(path, "wb");
+    if (!rw) return false;
+    bool ok = SDL_RWwrite(rw, file.data(), 1, file.size()) == file.size();
+    SDL_RWclose(rw);
+    return ok;
+}
+
+bool LoadReplay(const char* path, Replay& out) {
+    SDL_RWops* rw = SDL_RWFromFile(path, "rb");
+    if (!rw) return false;
+    Sint64 size = SDL_RWsize(rw);
+    std::vector<Uint8> file(size > 0 ? (size_t)size : 0);
+    bool ok = !file.empty() && SDL_RWread(rw, file.data(), 1, file.size()) == file.size();
+    SDL_RWclose(rw);
+    if (!ok) return false;
+
+    size_t offset = 0;
+    Uint32 magic = 0;
+    if (!ReadU32(file.data(), file.size(), offset, magic) || magic != REPLAY_MAGIC) return false;
+    if (offset + 4 > file.size() || file[offset] != REPLAY_VERSION) return false;
+    out.header.physicsHz = (Uint16)(file[offset + 1] | (file[offset + 2] << 8));
+    out.header.numeric = file[offset + 3];
+    offset += 4;
+    if (!ReadU32(file.data(), file.size(), offset, out.header.levelId) ||
+        !ReadU32(file.data(), file.size(), offset, out.header.seed) ||
+        !ReadU32(file.data(), file.size(), offset, out.header.steps)) return false;
+
+    out.runs.assign(file.begin() + offset, file.end());
+    return true;
+}
+
+// Input for the next step; false once the replay is exhausted (or corrupt).
+bool NextReplayInput(const Replay& replay, ReplayCursor& cursor, InputState& input) {
+    if (cursor.stepsLeft == 0) {
+        const Uint8* data = replay.runs.data();
+        size_t size = replay.runs.size();
+        if (cursor.offset >= size) return false;
+
+        Uint8 b = data[cursor.offset++];
+        cursor.state = b & 0x0F;
+        cursor.stepsLeft = b >> 4;
+        if (cursor.stepsLeft == 0 && (!ReadVarint(data, size, cursor.offset, cursor.stepsLeft) || cursor.stepsLeft == 0)) {
+            return false;
+        }
+    }
+    cursor.stepsLeft--;
+    input = UnpackInput(cursor.state);
+    return true;
+}
+
+// ==========================================
+// ROLLBACK
+// ==========================================
+
+void StartRollbackSession(RollbackSession& session, int localPlayer) {
+    for (auto& player : session.state.players) player = SpawnPlayer();
+    session.localPlayer = localPlayer;
+    session.frame = 0;
+    session.remoteConfirmed = 0;
+    session.rollbackFrame = ROLLBACK_NONE;
+    session.lastRemote = InputState();
+    session.rollbacks = 0;
+    session.resimulatedSteps = 0;
+}
+
+// The remote player keeps doing what they last did; presses aren't repeated
+InputState PredictRemoteInput(const InputState& last) {
+    InputState predicted = last;
+    predicted.jumpPressed = false;
+    return predicted;
+}
+
+bool SameInput(const InputState& a, const InputState& b) {
+    return a.left == b.left && a.right == b.right && a.jumpPressed == b.jumpPressed && a.jumpHeld == b.jumpHeld;
+}
+
+void SimulateRaceFrame(RollbackSession& session, World& level, Uint32 frame) {
+    int slot = frame % ROLLBACK_RING;
+    int remote = 1 - session.localPlayer;
+    if (frame >= session.remoteConfirmed) session.inputs[slot][remote] = PredictRemoteInput(session.lastRemote);
+
+    session.snapshots[slot] = session.state;
+    PoseDynamicObstacles(level, frame);
+    for (int p = 0; p < RACE_PLAYERS; p++) {
+        UpdatePhysics(session.state.players[p], session.inputs[slot][p], level, TIME_STEP);
+    }
+}
+
+// Remote input for 'frame', which must be the next unconfirmed one. Returns
+// false if it's out of order or too far ahead to store.
+bool ReceiveRemoteInput(RollbackSession& session, Uint32 frame, const InputState& input) {
+    if (frame != session.remoteConfirmed || frame >= session.frame + ROLLBACK_MAX_STEPS) return false;
+
+    int slot = frame % ROLLBACK_RING;
+    int remote = 1 - session.localPlayer;
+    if (frame < session.frame && !SameInput(session.inputs[slot][remote], input)) {
+        session.rollbackFrame = std::min(session.rollbackFrame, frame);
+    }
+    session.inputs[slot][remote] = input;
+    session.lastRemote = input;
+    session.remoteConfirmed++;
+    return true;
+}
+
+// Rewinds to the first mispredicted frame and replays up to the present
+// with the corrected inputs (later unconfirmed frames are predicted again).
+void ResolveRollback(RollbackSession& session, World& level) {
+    if (session.rollbackFrame == ROLLBACK_NONE) return;
+
+    Uint32 first = session.rollbackFrame;
+    session.state = session.snapshots[first % ROLLBACK_RING];
+    for (Uint32 f = first; f < session.frame; f++) SimulateRaceFrame(session, level, f);
+    session.rollbacks++;
+    session.resimulatedSteps += session.frame - first;
+    session.rollbackFrame = ROLLBACK_NONE;
+}
+
+// False while we're ROLLBACK_MAX_STEPS ahead of the remote player: wait for them
+bool CanAdvanceRollback(const RollbackSession& session) {
+    return session.frame - session.remoteConfirmed < (Uint32)ROLLBACK_MAX_STEPS;
+}
+
+// One fixed step of the race with this peer's input. Returns false (and
+// simulates nothing) when it has to wait for the remote player.
+bool AdvanceRollback(RollbackSession& session, World& level, const InputState& localInput) {
+    ResolveRollback(session, level);
+    if (!CanAdvanceRollback(session)) return false;
+
+    session.inputs[session.frame % ROLLBACK_RING][session.localPlayer] = localInput;
+    SimulateRaceFrame(session, level, session.frame);
+    session.frame++;
+    return true;
+}
+
+// ==========================================
+// HEADLESS SIMULATION
+// ==========================================
+
+// Command line switches. Everything defaults to the normal windowed game.
+struct LaunchOptions {
+    bool headless = false; // --headless: bot playtests without SDL video
+    int sessions = 100;    // --sessions N
+    int steps = 36000;     // --steps N (per session; 36000 = 10 minutes at 60 Hz)
+    Uint32 seed = 1;       // --seed N
+    bool batch = false;    // --batch: simulate all sessions at once as a PlayerBatch
+    int threads = 1;       // --threads N: threads for --batch and --validate (0 = all cores)
+    const char* replay = nullptr; // --replay FILE: simulate a recorded session, no video
+    const char* record = nullptr; // --record FILE: where to save this session's inputs
+    const char* telemetry = nullptr; // --telemetry FILE: where to write this session's metrics ("" = nowhere)
+    const char* level = nullptr;  // --level FILE: binary level to play (built-in level otherwise)
+    const char* exportLevel = nullptr; // --export-level FILE: write the built-in level and quit
+    int generate = 0;    // --generate N: play, validate or --export-level an N-screen generated climb instead
+    bool stream = false; // --stream: stream the --level file in chunks instead of loading it whole
+    bool lowLatency = false; // --low-latency: timestamped input per step, vsync off + frame limiter
+    int fps = 0;             // --fps N: target frame rate for adaptive quality and the --low-latency limiter (0 = display refresh rate)
+    bool rollbackTest = false; // --rollback-test: two bot peers over a laggy fake connection, checked for desyncs
+    bool benchmark = false;  // --benchmark: run the benchmark suite, JSON on stdout
+    bool validate = false;   // --validate: check every platform can be reached from the spawn
+    int benchMax = 1000000;  // --bench-max N: skip synthetic levels bigger than N obstacles
+    int quality = -1;        // --quality N: pin QUALITY_TIERS[N] (0 = full) instead of adapting
+};
+
+LaunchOptions ParseLaunchOptions(int argc, char* argv[]) {
+    LaunchOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--headless") == 0) options.headless = true;
+        else if (strcmp(argv[i], "--sessions") == 0 && hasValue) options.sessions = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--steps") == 0 && hasValue) options.steps = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue) options.seed = (Uint32)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--batch") == 0) options.batch = true;
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) options.threads = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--replay") == 0 && hasValue) options.replay = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && hasValue) options.record = argv[++i];
+        else if (strcmp(argv[i], "--telemetry") == 0 && hasValue) options.telemetry = argv[++i];
+        else if (strcmp(argv[i], "--level") == 0 && hasValue) options.level = argv[++i];
+        else if (strcmp(argv[i], "--export-level") == 0 && hasValue) options.exportLevel = argv[++i];
+        else if (strcmp(argv[i], "--generate") == 0 && hasValue) options.generate = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--stream") == 0) options.stream = true;
+        else if (strcmp(argv[i], "--benchmark") == 0) options.benchmark = true;
+        else if (strcmp(argv[i], "--validate") == 0) options.validate = true;
+        else if (strcmp(argv[i], "--rollback-test") == 0) options.rollbackTest = true;
+        else if (strcmp(argv[i], "--low-latency") == 0) options.lowLatency = true;
+        else if (strcmp(argv[i], "--fps") == 0 && hasValue) options.fps = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--bench-max") == 0 && hasValue) options.benchMax = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--quality") == 0 && hasValue) options.quality = std::clamp(atoi(argv[++i]), 0, QUALITY_TIER_COUNT - 1);
+    }
+    return options;
+}
+
+// The level chosen on the command line (--level, else --generate), falling
+// back to the built-in one.
+void LoadSelectedLevel(World& level, const LaunchOptions& options) {
+    if (options.level && LoadLevelFile(level, options.level)) return;
+    if (options.generate) GenerateClimbLevel(level, options.generate, options.seed);
+    else LoadLevel(level);
+}
+
+// Deterministic scripted player: holds a random direction for a random
+// number of steps and taps or holds jump now and then.
+struct BotScript {
+    Uint32 rng;
+    int stepsLeft;
+    int jumpStepsLeft;
+    InputState input;
+};
+
+Uint32 NextRandom(Uint32& state) {
+    // xorshift32, identical on every platform
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+BotScript MakeBot(Uint32 seed) {
+    BotScript bot = {};
+    bot.rng = seed ? seed : 0x9E3779B9u;
+    return bot;
+}
+
+InputState NextBotInput(BotScript& bot) {
+    bot.input.jumpPressed = false;
+
+    if (bot.stepsLeft <= 0) {
+        Uint32 r = NextRandom(bot.rng);
+        bot.input.left = (r % 3) == 0;
+        bot.input.right = (r % 3) == 1;
+        bot.stepsLeft = 10 + (int)((r >> 8) % 50);
+    }
+    bot.stepsLeft--;
+
+    if (bot.jumpStepsLeft > 0) {
+        bot.jumpStepsLeft--;
+        if (bot.jumpStepsLeft == 0) bot.input.jumpHeld = false;
+    } else if (NextRandom(bot.rng) % 40 == 0) {
+        bot.input.jumpPressed = true;
+        bot.input.jumpHeld = true;
+        bot.jumpStepsLeft = 1 + (int)(NextRandom(bot.rng) % 30);
+    }
+    return bot.input;
+}
+
+// FNV-1a over the simulated state; equal hashes mean identical trajectories.
+Uint64 HashBytes(Uint64 hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename S>
+Uint64 HashPlayer(Uint64 hash, const PlayerT<S>& player) {
+    hash = HashBytes(hash, &player.pos, sizeof(player.pos));
+    hash = HashBytes(hash, &player.vel, sizeof(player.vel));
+    hash = HashBytes(hash, &player.jumpBuffer, sizeof(player.jumpBuffer));
+    hash = HashBytes(hash, &player.coyote, sizeof(player.coyote));
+    return HashBytes(hash, &player.onGround, sizeof(player.onGround));
+}
+
+const Uint64 HASH_SEED = 14695981039346656037ull;
+
+// Runs bot sessions as fast as possible. Only the timer is used from SDL,
+// so this works on machines without a display or GPU.
+void RunHeadless(const LaunchOptions& options) {
+    World level;
+    LoadSelectedLevel(level, options);
+
+    Uint64 hash = HASH_SEED;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if (options.batch) {
+        // Same sessions in lockstep; produces the same hash as the scalar path
+        std::vector<BotScript> bots;
+        for (int session = 0; session < options.sessions; session++) {
+            bots.push_back(MakeBot(options.seed + (Uint32)session));
+        }
+        PlayerBatch batch;
+        ResizePlayerBatch(batch, bots.size(), SpawnPlayer());
+
+        JobSystem jobs;
+        StartJobSystem(jobs, options.threads - 1);
+        int threadCount = jobs.workerCount + 1;
+        for (int step = 0; step < options.steps; step++) {
+            for (size_t i = 0; i < bots.size(); i++) batch.input[i] = NextBotInput(bots[i]);
+            PoseDynamicObstacles(level, (Uint32)step);
+            UpdatePhysicsBatchParallel(jobs, batch, level, TIME_STEP);
+        }
+        StopJobSystem(jobs);
+        for (size_t i = 0; i < bots.size(); i++) hash = HashPlayer(hash, GetBatchPlayer(batch, i));
+
+        SDL_Log("jobs: %d threads, %llu jobs run, %llu stolen, %llu player steps",
+                threadCount, (unsigned long long)jobs.jobsRun.load(),
+                (unsigned long long)jobs.jobsStolen.load(), (unsigned long long)jobs.itemsRun.load());
+    } else {
+        // --record keeps the first session, so it can be checked with --replay
+        ReplayRecorder recorder;
+        StartReplayRecording(recorder, level.levelId, options.seed);
+
+        // --stream: a camera follows each bot and drives chunk residency, as in the game
+        ChunkStreamer streamer;
+        Camera camera = { 0, 0, level.cameraBounds };
+        if (options.stream && options.level) {
+            UpdateCamera(camera, SpawnPlayer());
+            if (!OpenChunkStreamer(streamer, level, options.level, CameraView(camera))) SDL_Log("stream: can't open %s", options.level);
+            camera.bounds = level.cameraBounds;
+        }
+
+        for (int session = 0; session < options.sessions; session++) {
+            Player player = SpawnPlayer();
+            BotScript bot = MakeBot(options.seed + (Uint32)session);
+            for (int step = 0; step < options.steps; step++) {
+                if (streamer.open) {
+                    UpdateCamera(camera, player);
+                    UpdateChunkStreamer(streamer, level, CameraView(camera));
+                }
+                InputState input = NextBotInput(bot);
+                if (session == 0) RecordReplayStep(recorder, input);
+                PoseDynamicObstacles(level, (Uint32)step);
+                UpdatePhysics(player, input, level, TIME_STEP);
+            }
+            hash = HashPlayer(hash, player);
+
+            if (session == 0 && options.record) {
+                bool saved = SaveReplay(recorder, options.record);
+                SDL_Log("recorded session 0 to %s (%s): state hash %016llx", options.record,
+                        saved ? "ok" : "failed", (unsigned long long)HashPlayer(HASH_SEED, player));
+            }
+        }
+        if (streamer.open) SDL_Log("stream: %u obstacles resident at exit", (unsigned)(level.obstacles.size() - level.freeSlots.size()));
+        CloseChunkStreamer(streamer);
+    }
+
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    double totalSteps = (double)options.sessions * options.steps;
+    SDL_Log("headless%s: %d sessions x %d steps in %.2f ms (%.0f steps/ms), state hash %016llx",
+            options.batch ? " (batch)" : "", options.sessions, options.steps, ms, ms > 0 ? totalSteps / ms : 0.0, (unsigned long long)hash);
+}
+
+// Two bot peers racing over a simulated connection with random delay.
+// Both must end in exactly the state of a plain simulation of the real inputs.
+void RunRollbackTest(const LaunchOptions& options) {
+    World level;
+    LoadSelectedLevel(level, options);
+
+    struct Packet {
+        Uint32 frame;
+        InputState input;
+        int deliverAt; // Tick it arrives at the other peer
+    };
+    RollbackSession peers[RACE_PLAYERS];
+    BotScript bots[RACE_PLAYERS];
+    std::deque<Packet> wire[RACE_PLAYERS]; // wire[p]: player p's inputs, in flight
+    std::vector<InputState> history[RACE_PLAYERS];
+    Uint32 rng = options.seed ? options.seed : 1;
+    Uint32 steps = (Uint32)options.steps;
+    Uint64 stalls = 0;
+    std::vector<float> rollbackMs; // Duration of every step that had to rewind
+
+    for (int p = 0; p < RACE_PLAYERS; p++) {
+        StartRollbackSession(peers[p], p);
+        bots[p] = MakeBot(options.seed + (Uint32)p);
+    }
+
+    for (int tick = 0; peers[0].frame < steps || peers[1].frame < steps || !wire[0].empty() || !wire[1].empty(); tick++) {
+        for (int p = 0; p < RACE_PLAYERS; p++) {
+            RollbackSession& peer = peers[p];
+            if (peer.frame >= steps) {
+                ResolveRollback(peer, level);
+                continue;
+            }
+            if (!CanAdvanceRollback(peer)) {
+                stalls++;
+                continue;
+            }
+            InputState input = NextBotInput(bots[p]);
+            history[p].push_back(input);
+
+            bool rewinds = peer.rollbackFrame != ROLLBACK_NONE;
+            Uint64 start = SDL_GetPerformanceCounter();
+            AdvanceRollback(peer, level, input);
+            if (rewinds) rollbackMs.push_back((float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency()));
+
+            // 1-6 ticks of latency, delivered in order
+            int deliverAt = tick + 1 + (int)(NextRandom(rng) % 6);
+            if (!wire[p].empty()) deliverAt = std::max(deliverAt, wire[p].back().deliverAt);
+            wire[p].push_back({ peer.frame - 1, input, deliverAt });
+        }
+        for (int p = 0; p < RACE_PLAYERS; p++) {
+            while (!wire[p].empty() && wire[p].front().deliverAt <= tick) {
+                if (!ReceiveRemoteInput(peers[1 - p], wire[p].front().frame, wire[p].front().input)) break;
+                wire[p].pop_front();
+            }
+        }
+    }
+    for (auto& peer : peers) ResolveRollback(peer, level);
+
+    // Reference: the same inputs without any prediction
+    RaceState reference;
+    for (auto& player : reference.players) player = SpawnPlayer();
+    for (Uint32 f = 0; f < steps; f++) {
+        PoseDynamicObstacles(level, f);
+        for (int p = 0; p < RACE_PLAYERS; p++) UpdatePhysics(reference.players[p], history[p][f], level, TIME_STEP);
+    }
+
+    Uint64 expected = HASH_SEED;
+    for (const auto& player : reference.players) expected = HashPlayer(expected, player);
+    bool inSync = true;
+    for (const auto& peer : peers) {
+        Uint64 hash = HASH_SEED;
+        for (const auto& player : peer.state.players) hash = HashPlayer(hash, player);
+        inSync = inSync && hash == expected;
+        SDL_Log("rollback: peer %d, %u frames, %llu rollbacks, %llu steps re-simulated, state hash %016llx",
+                peer.localPlayer, peer.frame, (unsigned long long)peer.rollbacks,
+                (unsigned long long)peer.resimulatedSteps, (unsigned long long)hash);
+    }
+    std::sort(rollbackMs.begin(), rollbackMs.end());
+    float p99 = rollbackMs.empty() ? 0.0f : rollbackMs[(rollbackMs.size() - 1) * 99 / 100];
+    float worst = rollbackMs.empty() ? 0.0f : rollbackMs.back();
+    SDL_Log("rollback: %s, %llu stalls, step with rewind p99 %.4f ms, max %.4f ms", inSync ? "in sync" : "DESYNC",
+            (unsigned long long)stalls, p99, worst);
+}
+
+// Re-simulates a recorded session as fast as possible.
+void RunReplay(const LaunchOptions& options) {
+    Replay replay;
+    if (!LoadReplay(options.replay, replay)) {
+        SDL_Log("replay: can't read %s", options.replay);
+        return;
+    }
+
+    World level;
+    LoadSelectedLevel(level, options);
+    if (replay.header.levelId != level.levelId || replay.header.physicsHz != PHYSICS_HZ) {
+        SDL_Log("replay: recorded on level %u at %u Hz, this build has level %u at %d Hz",
+                replay.header.levelId, replay.header.physicsHz, level.levelId, PHYSICS_HZ);
+        return;
+    }
+    if (replay.header.numeric != PHYSICS_NUMERIC) {
+        SDL_Log("replay: recorded with %s physics, this build uses %s",
+                replay.header.numeric ? "fixed-point" : "float", PHYSICS_NUMERIC ? "fixed-point" : "float");
+        return;
+    }
+
+    Player player = SpawnPlayer();
+    ReplayCursor cursor;
+    InputState input;
+    Uint32 steps = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (NextReplayInput(replay, cursor, input)) {
+        PoseDynamicObstacles(level, steps);
+        UpdatePhysics(player, input, level, TIME_STEP);
+        steps++;
+    }
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+    SDL_Log("replay: %u of %u steps (%u bytes of input) in %.2f ms, state hash %016llx",
+            steps, replay.header.steps, (unsigned)replay.runs.size(), ms,
+            (unsigned long long)HashPlayer(HASH_SEED, player));
+}
+
+// ==========================================
+// BENCHMARKS
+// ==========================================
+
+// Square field of random platforms above a floor, 'count' obstacles in total.
+// The field grows with the count so density (and work per step) stays the same.
+void GenerateBenchmarkLevel(World& level, int count, Uint32 seed) {
+    Uint32 rng = seed ? seed : 1;
+    int side = std::max(SCREEN_WIDTH, (int)(std::sqrt((double)count) * BENCH_SPACING));
+    int top = SCREEN_HEIGHT - side;
+
+    level.obstacles.clear();
+    level.freeSlots.clear();
+    level.streaming = false;
+    level.obstacles.reserve(count);
+    level.obstacles.push_back({ {0, 600, side, 120}, 0 }); // Floor
+    while ((int)level.obstacles.size() < count) {
+        int x = (int)(NextRandom(rng) % (Uint32)side);
+        int y = top + (int)(NextRandom(rng) % (Uint32)(side - SCREEN_HEIGHT + 600));
+        int w = 60 + (int)(NextRandom(rng) % 200);
+        level.obstacles.push_back({ {x, y, w, 20}, 0 });
+    }
+    level.cameraBounds = { 0, top, side, side };
+    level.levelId = 2000000 + (Uint32)count;
+}
+
+double BenchMs(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// Bots dropped at random spots across the field, stepped with number type S.
+// Returns the elapsed ms and folds the final states into 'hash'.
+template <typename S>
+double BenchPhysics(const World& level, Uint32 seed, Uint64& hash) {
+    Uint32 rng = seed ? seed : 1;
+    int side = level.cameraBounds.w;
+    PlayerT<S> spawn;
+    spawn.vel = { S(0), S(0) };
+    spawn.size = { S(32), S(64) };
+    spawn.onGround = false;
+    spawn.jumpBuffer = 0;
+    spawn.coyote = 0;
+    spawn.ground = -1; // As SpawnPlayer, which only builds the Scalar type
+    spawn.groundAt = { 0, 0 };
+    std::vector<PlayerT<S>> players(BENCH_PLAYERS, spawn);
+    std::vector<BotScript> bots;
+    for (int i = 0; i < BENCH_PLAYERS; i++) {
+        players[i].pos = { S((int)(NextRandom(rng) % (Uint32)side)), S(level.cameraBounds.y + (int)(NextRandom(rng) % (Uint32)side)) };
+        bots.push_back(MakeBot(seed + (Uint32)i));
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int step = 0; step < BENCH_STEPS; step++) {
+        for (int i = 0; i < BENCH_PLAYERS; i++) UpdatePhysics(players[i], NextBotInput(bots[i]), level, TIME_STEP);
+    }
+    double ms = BenchMs(start);
+    for (const auto& player : players) hash = HashPlayer(hash, player);
+    return ms;
+}
+
+// Prints one JSON object to stdout, one line per level size, fixed key order
+// so runs can be diffed or parsed across commits. Logs go to SDL_Log (stderr).
+void RunBenchmarks(const LaunchOptions& options) {
+#if defined(__EMSCRIPTEN__)
+    const char* platform = "wasm";
+#else
+    const char* platform = "native";
+#endif
+#if defined(UPHILL_SIMD_SSE2)
+    const char* simd = "sse2";
+#elif defined(UPHILL_SIMD_NEON)
+    const char* simd = "neon";
+#elif defined(UPHILL_SIMD_WASM)
+    const char* simd = "wasm128";
+#else
+    const char* simd = "none";
+#endif
+
+    // Software renderer on an offscreen surface: no window or GPU needed, works under node
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    renderer = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+    if (renderer) {
+        InitControls();
+        CreateTileAtlas();
+    }
+
+    printf("{\"benchmark\":\"uphill\",\"platform\":\"%s\",\"simd\":\"%s\",\"players\":%d,\"steps\":%d,\"results\":[\n",
+           platform, simd, BENCH_PLAYERS, BENCH_STEPS);
+    bool first = true;
+    for (int count : BENCH_SIZES) {
+        if (count > options.benchMax) continue;
+
+        // Level generation + spatial grid build
+        World level;
+        GenerateBenchmarkLevel(level, count, options.seed);
+        Uint64 start = SDL_GetPerformanceCounter();
+        BuildSpatialGrid(level.grid, level.obstacles);
+        double buildMs = BenchMs(start);
+
+        // Level file round trip
+        start = SDL_GetPerformanceCounter();
+        bool saved = SaveLevelFile(level, BENCH_LEVEL_FILE);
+        double saveMs = BenchMs(start);
+        World loaded;
+        start = SDL_GetPerformanceCounter();
+        bool ok = saved && LoadLevelFile(loaded, BENCH_LEVEL_FILE) && AuthoredObstacles(loaded).size() == level.obstacles.size();
+        double loadMs = BenchMs(start);
+        std::remove(BENCH_LEVEL_FILE);
+
+        // Physics in this build's number type, then in both so float and fixed compare per platform.
+        // Fixed point is skipped (null) on levels wider than it can represent.
+        bool fixedFits = FitsFixedPointRange(level);
+        bool scalarFits = fixedFits || !PHYSICS_NUMERIC;
+        Uint64 hash = HASH_SEED;
+        double physicsMs = scalarFits ? BenchPhysics<Scalar>(level, options.seed, hash) : 0;
+        Uint64 unused = HASH_SEED;
+        double floatMs = BenchPhysics<float>(level, options.seed, unused);
+        double fixedMs = fixedFits ? BenchPhysics<Fixed>(level, options.seed, unused) : 0;
+        int side = level.cameraBounds.w;
+
+        // Render submission, culled path (a baked layer would hide the cost)
+        double renderMs = 0;
+        if (renderer) {
+            Camera camera = { 0, 0, level.cameraBounds };
+            Player focus = SpawnPlayer();
+            focus.pos = { side * 0.5f, level.cameraBounds.y + side * 0.5f };
+            UpdateCamera(camera, focus);
+            start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < BENCH_RENDER_FRAMES; frame++) {
+                camera.x += 4; // Keep it moving so nothing gets cached by accident
+                Render(level, focus, camera, 1.0f);
+            }
+            renderMs = BenchMs(start) / BENCH_RENDER_FRAMES;
+        }
+
+        double steps = (double)BENCH_PLAYERS * BENCH_STEPS;
+        char physicsRate[32] = "null", floatRate[32], fixedRate[32] = "null";
+        if (scalarFits) SDL_snprintf(physicsRate, sizeof(physicsRate), "%.0f", physicsMs > 0 ? steps * 1000.0 / physicsMs : 0.0);
+        SDL_snprintf(floatRate, sizeof(floatRate), "%.0f", floatMs > 0 ? steps * 1000.0 / floatMs : 0.0);
+        if (fixedFits) SDL_snprintf(fixedRate, sizeof(fixedRate), "%.0f", fixedMs > 0 ? steps * 1000.0 / fixedMs : 0.0);
+        printf("%s{\"obstacles\":%d,\"build_ms\":%.3f,\"save_ms\":%.3f,\"load_ms\":%.3f,\"load_ok\":%s,"
+               "\"physics_steps_per_sec\":%s,\"float_steps_per_sec\":%s,\"fixed_steps_per_sec\":%s,"
+               "\"render_submit_ms\":%.4f,\"visible_obstacles\":%d,\"state_hash\":\"%016llx\"}",
+               first ? "" : ",\n", count, buildMs, saveMs, loadMs, ok ? "true" : "false",
+               physicsRate, floatRate, fixedRate, renderMs, (int)visibleObstacles.size(), (unsigned long long)hash);
+        fflush(stdout);
+        first = false;
+    }
+
+    // Particles: a full screen of long-lived ones, so the count stays at BENCH_PARTICLES
+    ParticlePool pool;
+    InitParticlePool(pool, BENCH_PARTICLES);
+    SDL_Rect view = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    for (int i = 0; i < BENCH_PARTICLES; i++) {
+        EmitParticle(pool, ParticleRandom(pool, 0, SCREEN_WIDTH), ParticleRandom(pool, 0, SCREEN_HEIGHT),
+                     ParticleRandom(pool, -5, 5), ParticleRandom(pool, -5, 5), 1000.0f, 0.0f, 3.0f, SDL_Color{ 255, 255, 255, 255 });
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < BENCH_RENDER_FRAMES; frame++) UpdateParticles(pool, TIME_STEP);
+    double particleUpdateMs = BenchMs(start) / BENCH_RENDER_FRAMES;
+    double particleRenderMs = 0;
+    if (renderer) {
+        start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < BENCH_RENDER_FRAMES; frame++) RenderParticles(pool, view);
+        particleRenderMs = BenchMs(start) / BENCH_RENDER_FRAMES;
+    }
+    printf("\n],\"particles\":{\"count\":%d,\"update_ms\":%.4f,\"render_submit_ms\":%.4f}}\n",
+           pool.count, particleUpdateMs, particleRenderMs);
+
+    if (tileAtlas) SDL_DestroyTexture(tileAtlas);
+    tileAtlas = nullptr;
+    if (renderer) SDL_DestroyRenderer(renderer);
+    renderer = nullptr;
+    if (target) SDL_FreeSurface(target);
+}
+
+// ==========================================
+// LEVEL VALIDATION
+// ==========================================
+// --validate: checks that every platform can be stood on, starting from the
+// spawn. The search runs the real UpdatePhysics, so any route it finds can
+// be played exactly as found. Nodes are standing states and edges are short
+// maneuvers (walks, and jumps with a few hold times and steering delays)
+// simulated until the player lands again. Each wave of nodes is expanded
+// across the job system, with new states deduplicated by hash in a
+// lock-free set.
+
+// Open-addressing set of nonzero keys. Slots only ever go from 0 to a key,
+// with one CAS, so inserts from any number of threads need no locks.
+struct ConcurrentKeySet {
+    std::unique_ptr<std::atomic<Uint64>[]> slots;
+    Uint64 mask = 0;
+    Uint64 limit = 0; // Inserts stop here (3/4 full) so probe runs stay short
+    std::atomic<Uint64> count{0};
+    std::atomic<bool> full{false};
+};
+
+void InitKeySet(ConcurrentKeySet& set, int bits) {
+    Uint64 capacity = 1ull << bits;
+    set.slots.reset(new std::atomic<Uint64>[capacity]());
+    set.mask = capacity - 1;
+    set.limit = capacity / 4 * 3;
+    set.count = 0;
+    set.full = false;
+}
+
+// True if 'key' is new. Once the set is full every key counts as seen.
+bool InsertKey(ConcurrentKeySet& set, Uint64 key) {
+    for (Uint64 slot = (key ^ (key >> 29)) & set.mask;; slot = (slot + 1) & set.mask) {
+        Uint64 current = set.slots[slot].load(std::memory_order_relaxed);
+        if (current == key) return false;
+        if (current != 0) continue;
+        if (set.count.load(std::memory_order_relaxed) >= set.limit) {
+            set.full.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        if (set.slots[slot].compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+            set.count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (current == key) return false; // Another thread inserted it first
+    }
+}
+
+// A canned input sequence; steps count from the start of the maneuver.
+struct Maneuver {
+    int direction; // -1 left, 0 none, +1 right
+    int steerStep; // Direction held from this step on (a jump rises straight first)
+    int jumpSteps; // Steps jump is held (0 = walk)
+    int walkSteps; // Walks: steps the direction is held (standing still counts)
+};
+
+const Maneuver VALIDATE_MANEUVERS[] = {
+    { -1, 0, 0, 2 }, { 1, 0, 0, 2 },   // Shuffle
+    { -1, 0, 0, 8 }, { 1, 0, 0, 8 },   // Walk (and off edges)
+    { 0, 0, 0, PHYSICS_HZ / 2 },       // Wait for a dynamic obstacle
+    // Jump heights from a 53 px hop to the full 197 px, fine enough to
+    // squeeze under a low ceiling
+    { 0, 0, 3, 0 },  { -1, 0, 3, 0 },  { 1, 0, 3, 0 },  { -1, 12, 3, 0 },  { 1, 12, 3, 0 },
+    { 0, 0, 6, 0 },  { -1, 0, 6, 0 },  { 1, 0, 6, 0 },  { -1, 12, 6, 0 },  { 1, 12, 6, 0 },
+    { 0, 0, 9, 0 },  { -1, 0, 9, 0 },  { 1, 0, 9, 0 },  { -1, 12, 9, 0 },  { 1, 12, 9, 0 },
+    { 0, 0, 12, 0 }, { -1, 0, 12, 0 }, { 1, 0, 12, 0 }, { -1, 12, 12, 0 }, { 1, 12, 12, 0 },
+    { 0, 0, 16, 0 }, { -1, 0, 16, 0 }, { 1, 0, 16, 0 }, { -1, 12, 16, 0 }, { 1, 12, 16, 0 },
+    { 0, 0, 24, 0 }, { -1, 0, 24, 0 }, { 1, 0, 24, 0 }, { -1, 12, 24, 0 }, { 1, 12, 24, 0 },
+};
+const int VALIDATE_MANEUVER_COUNT = (int)(sizeof(VALIDATE_MANEUVERS) / sizeof(VALIDATE_MANEUVERS[0]));
+
+struct ValidateNode {
+    Player player;
+    Uint32 step; // Dynamic obstacles are posed for this step
+};
+
+struct LevelValidator {
+    const World* level;
+    std::vector<World> worlds;       // One private copy per thread: dynamic obstacles are posed per node
+    std::atomic<Uint64> freeWorlds;  // Bit per copy not in use
+    SpatialGrid reachGrid;           // DynamicObstacleReach of level->dynamics[i], stored as i
+    std::vector<int> authoredOf;     // Collision obstacle -> authored obstacle (dynamic ones only, else -1)
+    std::vector<Uint8> platform;     // Authored obstacle can be stood on at all
+    std::unique_ptr<std::atomic<Uint8>[]> reached; // Authored obstacle was stood on
+    std::atomic<int> reachedCount{0};                // Platforms among them
+    ConcurrentKeySet seen;
+
+    std::vector<ValidateNode> frontier, next;
+    std::atomic<size_t> nextCount{0};
+};
+
+thread_local std::vector<int> validateHits; // Scratch for grid queries while validating
+
+// Lock-free pool of world copies. ParallelFor runs at most one job per
+// thread at a time, so a free copy always exists.
+int AcquireWorld(LevelValidator& v) {
+    Uint64 mask = v.freeWorlds.load(std::memory_order_acquire);
+    while (true) {
+        if (mask == 0) {
+            mask = v.freeWorlds.load(std::memory_order_acquire);
+            continue;
+        }
+        int bit = 0;
+        while (!((mask >> bit) & 1)) bit++;
+        if (v.freeWorlds.compare_exchange_weak(mask, mask & ~(1ull << bit), std::memory_order_acquire)) return bit;
+    }
+}
+
+void ReleaseWorld(LevelValidator& v, int index) {
+    v.freeWorlds.fetch_or(1ull << index, std::memory_order_release);
+}
+
+// Poses only the dynamic obstacles that could touch the player this step;
+// the rest are posed whenever the player next comes near them.
+void PoseDynamicObstaclesNear(LevelValidator& v, World& level, const Player& player, Uint32 step) {
+    if (level.dynamics.empty()) return;
+    SDL_Rect area = { FloorToInt(player.pos.x) - VALIDATE_POSE_MARGIN, FloorToInt(player.pos.y) - VALIDATE_POSE_MARGIN,
+                      CeilToInt(player.size.x) + 2 * VALIDATE_POSE_MARGIN, CeilToInt(player.size.y) + 2 * VALIDATE_POSE_MARGIN };
+    QuerySpatialGrid(v.reachGrid, area, validateHits);
+    for (int i : validateHits) PoseDynamicObstacle(level, level.dynamics[i], step);
+}
+
+// Plays one maneuver from a standing node. True if the player ends up
+// standing again (not still airborne, not fallen out of the level).
+bool RunManeuver(LevelValidator& v, World& level, const Maneuver& m, ValidateNode& node) {
+    Player& player = node.player;
+    bool leftGround = false;
+    int minSteps = std::max(m.walkSteps, m.jumpSteps);
+    for (int k = 0; k < VALIDATE_MAX_MANEUVER_STEPS; k++) {
+        bool steering = k >= m.steerStep && (m.jumpSteps > 0 || k < m.walkSteps);
+        InputState input;
+        input.left = steering && m.direction < 0;
+        input.right = steering && m.direction > 0;
+        input.jumpPressed = m.jumpSteps > 0 && k == 0;
+        input.jumpHeld = k < m.jumpSteps;
+
+        PoseDynamicObstaclesNear(v, level, player, node.step);
+        UpdatePhysics(player, input, level, TIME_STEP);
+        node.step++;
+        if (ToFloat(player.pos.y) > SCREEN_HEIGHT) return false; // Falling out; the respawn is just below
+        if (!player.onGround) leftGround = true;
+        if (player.onGround && k + 1 >= minSteps && (leftGround || m.jumpSteps == 0)) return true;
+    }
+    return false;
+}
+
+// A state is kept only if it is new in at least one respect (novelty
+// pruning): a new place (obstacle, cell, direction of motion), or, near
+// dynamic obstacles, a new arrival time on the obstacle stood on. Keying on
+// the pair would multiply the two; this way the state count grows with
+// their sum.
+Uint64 ValidatePlaceKey(const ValidateNode& node) {
+    const Player& player = node.player;
+    int key[4] = { player.ground, FloorToInt(player.pos.x) / VALIDATE_CELL, FloorToInt(player.pos.y) / VALIDATE_CELL,
+                   (player.vel.x > 0) - (player.vel.x < 0) };
+    Uint64 hash = HashBytes(HASH_SEED, key, sizeof(key));
+    return hash ? hash : 1; // 0 marks empty slots
+}
+
+// 0 when no dynamic obstacle is close enough for timing to matter
+Uint64 ValidateTimingKey(LevelValidator& v, const ValidateNode& node) {
+    const Player& player = node.player;
+    SDL_Rect area = { FloorToInt(player.pos.x) - VALIDATE_DYNAMIC_RADIUS, FloorToInt(player.pos.y) - VALIDATE_DYNAMIC_RADIUS,
+                      2 * VALIDATE_DYNAMIC_RADIUS, 2 * VALIDATE_DYNAMIC_RADIUS };
+    QuerySpatialGrid(v.reachGrid, area, validateHits);
+    if (validateHits.empty()) return 0;
+
+    int key[2] = { player.ground, (int)(node.step / VALIDATE_PHASE_STEPS % VALIDATE_PHASES) };
+    Uint64 hash = HashBytes(HASH_SEED ^ 1, key, sizeof(key));
+    return hash ? hash : 1;
+}
+
+// Inserts both keys and says if either was new
+bool IsNovel(LevelValidator& v, const ValidateNode& node) {
+    bool place = InsertKey(v.seen, ValidatePlaceKey(node));
+    Uint64 timing = ValidateTimingKey(v, node);
+    bool time = timing && InsertKey(v.seen, timing);
+    return place || time;
+}
+
+void MarkReached(LevelValidator& v, int authored) {
+    if (v.platform[authored] && v.reached[authored].exchange(1, std::memory_order_relaxed) == 0) {
+        v.reachedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Marks what the player is standing on, in authored obstacles
+void MarkStoodOn(LevelValidator& v, const Player& player) {
+    if (player.ground < 0) return;
+    int authored = v.authoredOf[player.ground];
+    if (authored >= 0) {
+        MarkReached(v, authored);
+        return;
+    }
+    // A merged collider may stand for several authored rects along its top
+    SDL_Rect feet = { FloorToInt(player.pos.x), (int)std::lround(ToFloat(player.pos.y + player.size.y)), CeilToInt(player.size.x), 1 };
+    const std::vector<Obstacle>& obstacles = AuthoredObstacles(*v.level);
+    QuerySpatialGrid(AuthoredGrid(*v.level), feet, validateHits);
+    for (int i : validateHits) {
+        const SDL_Rect& rect = obstacles[i].rect;
+        if (obstacles[i].type == OBSTACLE_SOLID && rect.y == feet.y && CheckCollision(feet, rect)) {
+            MarkReached(v, i);
+        }
+    }
+}
+
+// Items are (frontier node, maneuver) pairs
+void RunValidateJob(void* context, size_t begin, size_t end) {
+    LevelValidator& v = *(LevelValidator*)context;
+    int worldIndex = AcquireWorld(v);
+    World& level = v.worlds[worldIndex];
+    for (size_t i = begin; i < end; i++) {
+        ValidateNode node = v.frontier[i / VALIDATE_MANEUVER_COUNT];
+        if (!RunManeuver(v, level, VALIDATE_MANEUVERS[i % VALIDATE_MANEUVER_COUNT], node) || !IsNovel(v, node)) continue;
+        MarkStoodOn(v, node.player);
+        v.next[v.nextCount.fetch_add(1, std::memory_order_relaxed)] = node;
+    }
+    ReleaseWorld(v, worldIndex);
+}
+
+// A platform counts if the player fits on top of it somewhere inside the
+// level bounds; tops buried in walls or outside the camera bounds don't.
+bool IsPlatform(const World& level, const Obstacle& obs, const Player& spawn) {
+    if (obs.type == OBSTACLE_FREE) return false;
+    int w = CeilToInt(spawn.size.x), h = CeilToInt(spawn.size.y);
+    const SDL_Rect& bounds = level.cameraBounds;
+    int first = obs.rect.x, last = obs.rect.x + obs.rect.w - w;
+    if (last < first) first = last = obs.rect.x + (obs.rect.w - w) / 2; // Narrower than the player
+    for (int x = first; x <= last; x += VALIDATE_CELL) {
+        SDL_Rect slot = { x, obs.rect.y - h, w, h };
+        if (slot.x < bounds.x || slot.y < bounds.y || slot.x + w > bounds.x + bounds.w) continue;
+        if (IsDynamicObstacle(obs.type)) return true;
+        QuerySpatialGrid(level.grid, slot, validateHits);
+        bool blocked = false;
+        for (int i : validateHits) {
+            const Obstacle& other = level.obstacles[i];
+            if (!IsDynamicObstacle(other.type) && CheckCollision(slot, other.rect)) blocked = true;
+        }
+        if (!blocked) return true;
+    }
+    return false;
+}
+
+// Returns true if every platform was reached
+bool RunValidation(const LaunchOptions& options) {
+    World level;
+    LoadSelectedLevel(level, options);
+    PoseDynamicObstacles(level, 0);
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    JobSystem jobs;
+    StartJobSystem(jobs, options.threads - 1);
+#ifdef UPHILL_THREADS
+    if (jobs.workerCount > 63) { // One bit per world copy
+        StopJobSystem(jobs);
+        StartJobSystem(jobs, 63);
+    }
+#endif
+    int threadCount = jobs.workerCount + 1;
+
+    LevelValidator v;
+    v.level = &level;
+    v.worlds.assign(threadCount, level);
+    v.freeWorlds = threadCount == 64 ? ~0ull : (1ull << threadCount) - 1;
+
+    std::vector<Obstacle> reach;
+    for (const DynamicObstacle& d : level.dynamics) reach.push_back({ DynamicObstacleReach(level.obstacles[d.index].type, d.home), OBSTACLE_SOLID });
+    BuildSpatialGrid(v.reachGrid, reach);
+
+    const std::vector<Obstacle>& authored = AuthoredObstacles(level);
+    v.authoredOf.assign(level.obstacles.size(), -1);
+    for (const DynamicObstacle& d : level.dynamics) {
+        if (level.visuals.empty()) {
+            v.authoredOf[d.index] = d.index; // Nothing merged: both lists are the same
+            continue;
+        }
+        QuerySpatialGrid(level.visualGrid, d.home, validateHits);
+        for (int i : validateHits) {
+            if (authored[i].type == level.obstacles[d.index].type && SDL_RectEquals(&authored[i].rect, &d.home)) v.authoredOf[d.index] = i;
+        }
+    }
+    Player spawn = SpawnPlayer();
+    int platformCount = 0;
+    v.platform.resize(authored.size());
+    for (size_t i = 0; i < authored.size(); i++) {
+        v.platform[i] = IsPlatform(level, authored[i], spawn);
+        platformCount += v.platform[i];
+    }
+    v.reached.reset(new std::atomic<Uint8>[authored.size()]());
+    InitKeySet(v.seen, VALIDATE_SET_BITS);
+
+    // Waves: every node of one wave is expanded before the next starts.
+    // Stops early once every platform has been stood on.
+    ValidateNode first = { spawn, 0 };
+    RunManeuver(v, v.worlds[0], { 0, 0, 0, 1 }, first); // Drop onto the ground first
+    IsNovel(v, first);
+    MarkStoodOn(v, first.player);
+    v.frontier.push_back(first);
+    int waves = 0;
+    Uint64 states = 1;
+    while (!v.frontier.empty() && v.reachedCount < platformCount) {
+        v.next.resize(v.frontier.size() * VALIDATE_MANEUVER_COUNT);
+        v.nextCount = 0;
+        ParallelFor(jobs, v.frontier.size() * VALIDATE_MANEUVER_COUNT, VALIDATE_JOB_GRAIN, RunValidateJob, &v);
+        v.next.resize(v.nextCount);
+        v.frontier.swap(v.next);
+        states += v.frontier.size();
+        waves++;
+    }
+    StopJobSystem(jobs);
+
+    // "Not reached" rather than "unreachable": pruning by arrival phase can
+    // miss a route that needs one exact timing against a dynamic obstacle.
+    int listed = 0;
+    for (size_t i = 0; i < authored.size(); i++) {
+        if (v.platform[i] && !v.reached[i].load() && listed++ < VALIDATE_REPORT_LIMIT) {
+            const SDL_Rect& r = authored[i].rect;
+            SDL_Log("validate: platform %d not reached, at %d,%d %dx%d", (int)i, r.x, r.y, r.w, r.h);
+        }
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    SDL_Log("validate: level %u, %d of %d platforms reached, %llu states in %d waves, %.1f s on %d threads%s",
+            level.levelId, v.reachedCount.load(), platformCount, (unsigned long long)states, waves, seconds, threadCount,
+            v.seen.full ? " (state limit hit, search incomplete)" : "");
+    return v.reachedCount == platformCount;
+}
+
+// ==========================================
+// TELEMETRY
+// ==========================================
+// File layout (little-endian):
+//   u32 magic "UPTL", u8 version, u16 counter count, u16 histogram bucket us,
+//   u8 time buckets, u8 step buckets, u32 level id
+//   batch*: LEB128 ms since session start, LEB128 nonzero counter count N,
+//           N x (LEB128 index gap from the previous nonzero counter + 1, LEB128 value)
+// Values are counts since the previous batch. Histograms are mostly empty,
+// so skipping zero counters is what keeps a batch to tens of bytes.
+
+// Called from the frame loop: a relaxed add, no ordering with anything else
+inline void CountTelemetry(int counter, Uint32 amount = 1) {
+    telemetry.counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+int TelemetryTimeBucket(float ms) {
+    return std::clamp((int)(ms / TELEMETRY_BUCKET_MS), 0, TELEMETRY_TIME_BUCKETS - 1);
+}
+
+// Takes everything counted since the last batch and writes it out
+void FlushTelemetry(Telemetry& t) {
+    Uint32 values[TELEMETRY_COUNTER_COUNT];
+    Uint32 nonzero = 0;
+    for (int i = 0; i < TELEMETRY_COUNTER_COUNT; i++) {
+        values[i] = t.counters[i].exchange(0, std::memory_order_relaxed);
+        t.totals[i] += values[i];
+        if (values[i]) nonzero++;
+    }
+    if (nonzero == 0 || !t.file) return;
+
+    t.batch.clear();
+    AppendVarint(t.batch, (Uint32)((SDL_GetPerformanceCounter() - t.start) * 1000 / SDL_GetPerformanceFrequency()));
+    AppendVarint(t.batch, nonzero);
+    int previous = -1;
+    for (int i = 0; i < TELEMETRY_COUNTER_COUNT; i++) {
+        if (!values[i]) continue;
+        AppendVarint(t.batch, (Uint32)(i - previous));
+        AppendVarint(t.batch, values[i]);
+        previous = i;
+    }
+    if (SDL_RWwrite(t.file, t.batch.data(), 1, t.batch.size()) == t.batch.size()) {
+        t.batches++;
+        t.bytes += t.batch.size();
+    }
+}
+
+#ifdef UPHILL_THREADS
+void TelemetryWriterMain(Telemetry* t) {
+    std::unique_lock<std::mutex> guard(t->lock);
+    while (!t->quit) {
+        t->wake.wait_for(guard, std::chrono::milliseconds(TELEMETRY_FLUSH_MS), [&] { return t->quit; });
+        guard.unlock();
+        FlushTelemetry(*t); // Also runs once more on quit, for the session's tail
+        guard.lock();
+    }
+}
+#endif
+
+// Starts a session. Counting works even if 'path' can't be opened; only
+// the shutdown summary is left then.
+void OpenTelemetry(Telemetry& t, const char* path, Uint32 levelId) {
+    for (int i = 0; i < TELEMETRY_COUNTER_COUNT; i++) {
+        t.counters[i].store(0, std::memory_order_relaxed);
+        t.totals[i] = 0;
+    }
+    SDL_snprintf(t.path, sizeof(t.path), "%s", path);
+    t.start = SDL_GetPerformanceCounter();
+    t.batches = 0;
+    t.bytes = 0;
+    t.batch.reserve((size_t)TELEMETRY_COUNTER_COUNT * 10); // Worst case: every counter, two 5-byte varints
+
+    std::vector<Uint8> header;
+    AppendU32(header, TELEMETRY_MAGIC);
+    header.push_back(TELEMETRY_VERSION);
+    header.push_back((Uint8)(TELEMETRY_COUNTER_COUNT & 0xFF));
+    header.push_back((Uint8)(TELEMETRY_COUNTER_COUNT >> 8));
+    Uint16 bucketMicros = (Uint16)(TELEMETRY_BUCKET_MS * 1000.0f + 0.5f);
+    header.push_back((Uint8)(bucketMicros & 0xFF));
+    header.push_back((Uint8)(bucketMicros >> 8));
+    header.push_back((Uint8)TELEMETRY_TIME_BUCKETS);
+    header.push_back((Uint8)(MAX_STEPS_PER_FRAME + 1));
+    AppendU32(header, levelId);
+    t.file = path[0] ? SDL_RWFromFile(path, "wb") : nullptr;
+    if (t.file && SDL_RWwrite(t.file, header.data(), 1, header.size()) != header.size()) {
+        SDL_RWclose(t.file);
+        t.file = nullptr;
+    }
+    if (t.file) t.bytes = header.size();
+    else if (path[0]) SDL_Log("Couldn't write telemetry to %s", path);
+
+#ifdef UPHILL_THREADS
+    t.quit = false;
+    t.writer = std::thread(TelemetryWriterMain, &t);
+#else
+    t.nextFlush = t.start + (Uint64)TELEMETRY_FLUSH_MS * SDL_GetPerformanceFrequency() / 1000;
+#endif
+}
+
+#ifndef UPHILL_THREADS
+// No writer thread: the frame loop flushes when a batch is due
+void PollTelemetry(Telemetry& t, Uint64 now) {
+    if (now < t.nextFlush) return;
+    FlushTelemetry(t);
+    t.nextFlush = now + (Uint64)TELEMETRY_FLUSH_MS * SDL_GetPerformanceFrequency() / 1000;
+}
+#endif
+
+// Upper edge of the histogram bucket holding the given fraction of a session's samples
+float TelemetryPercentileMs(const Telemetry& t, int histogram, double fraction) {
+    Uint64 count = 0;
+    for (int i = 0; i < TELEMETRY_TIME_BUCKETS; i++) count += t.totals[histogram + i];
+    Uint64 seen = 0;
+    for (int i = 0; i < TELEMETRY_TIME_BUCKETS; i++) {
+        seen += t.totals[histogram + i];
+        if (seen > 0 && seen >= fraction * count) return (i + 1) * TELEMETRY_BUCKET_MS;
+    }
+    return 0.0f;
+}
+
+void CloseTelemetry(Telemetry& t) {
+#ifdef UPHILL_THREADS
+    if (t.writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(t.lock);
+            t.quit = true;
+        }
+        t.wake.notify_one();
+        t.writer.join();
+    }
+#else
+    FlushTelemetry(t);
+#endif
+    if (t.file) SDL_RWclose(t.file);
+    t.file = nullptr;
+
+    Uint64 frames = 0, steps = 0;
+    for (int i = 0; i <= MAX_STEPS_PER_FRAME; i++) {
+        frames += t.totals[TELEMETRY_STEPS_PER_FRAME + i];
+        steps += t.totals[TELEMETRY_STEPS_PER_FRAME + i] * i;
+    }
+    if (frames == 0) return;
+    SDL_Log("Telemetry: %llu frames, %llu steps (%llu dropped), %llu jumps, %llu deaths; frame time p50 %.1f ms, p99 %.1f ms",
+            (unsigned long long)frames, (unsigned long long)steps, (unsigned long long)t.totals[TELEMETRY_DROPPED_STEPS],
+            (unsigned long long)t.totals[TELEMETRY_JUMPS], (unsigned long long)t.totals[TELEMETRY_DEATHS],
+            TelemetryPercentileMs(t, TELEMETRY_FRAME_MS, 0.5), TelemetryPercentileMs(t, TELEMETRY_FRAME_MS, 0.99));
+    if (t.batches > 0) SDL_Log("Telemetry: %u batches, %llu bytes to %s", t.batches, (unsigned long long)t.bytes, t.path);
+}
+
+// ==========================================
+// ADAPTIVE QUALITY
+// ==========================================
+
+void ApplyQualityTier(QualityController& quality, int tier) {
+    quality.tier = std::clamp(tier, 0, QUALITY_TIER_COUNT - 1);
+    particles.limit = std::min(QUALITY_TIERS[quality.tier].particleLimit, (int)particles.x.size());
+    quality.slowFrames = 0;
+    quality.fastFrames = 0;
+}
+
+// Feeds one frame's timings. Over budget for QUALITY_DOWN_FRAMES in a row
+// drops a tier; clear headroom for QUALITY_UP_FRAMES in a row raises one.
+// Work time decides the way up, since a vsynced interval never shows headroom.
+void UpdateQuality(QualityController& quality, float frameMs, float workMs) {
+    if (!quality.adaptive || frameMs > QUALITY_OUTLIER_MS) return;
+    if (quality.frameMs == 0) {
+        quality.frameMs = frameMs;
+        quality.workMs = workMs;
+    }
+    quality.frameMs += (frameMs - quality.frameMs) * QUALITY_SMOOTHING;
+    quality.workMs += (workMs - quality.workMs) * QUALITY_SMOOTHING;
+
+    bool slow = quality.frameMs > quality.budgetMs * QUALITY_SLOW_FACTOR;
+    bool fast = quality.workMs < quality.budgetMs * QUALITY_FAST_FACTOR;
+    quality.slowFrames = slow ? quality.slowFrames + 1 : 0;
+    quality.fastFrames = fast ? quality.fastFrames + 1 : 0;
+
+    int tier = quality.tier;
+    if (quality.slowFrames >= QUALITY_DOWN_FRAMES && tier < QUALITY_TIER_COUNT - 1) tier++;
+    else if (quality.fastFrames >= QUALITY_UP_FRAMES && tier > 0) tier--;
+    if (tier == quality.tier) return;
+
+    ApplyQualityTier(quality, tier);
+    quality.changes++;
+    SDL_Log("Quality: tier %d (%.0f%% resolution, %d particles) at %.1f ms frames, %.1f ms work",
+            tier, QUALITY_TIERS[tier].renderScale * 100, QUALITY_TIERS[tier].particleLimit, quality.frameMs, quality.workMs);
+}
+
+// ==========================================
+// POWER SAVING
+// ==========================================
+
+// Fingerprint of everything a frame draws, in whole pixels: the view, the
+// player, dynamic obstacles in view and held buttons. A frame with the same
+// signature as the one on screen would look identical. Static geometry
+// isn't included; whatever replaces it must set GameLoop::redraw.
+Uint64 SceneSignature(const World& level, const Player& drawn, const Camera& camera, float alpha) {
+    SDL_Rect view = CameraView(camera);
+    Uint64 hash = HashBytes(HASH_SEED, &view, sizeof(view));
+    SDL_Point player = { (int)ToFloat(drawn.pos.x), (int)ToFloat(drawn.pos.y) };
+    hash = HashBytes(hash, &player, sizeof(player));
+    for (const DynamicObstacle& d : level.dynamics) {
+        if (!d.solid) continue;
+        const SDL_Rect& rect = level.obstacles[d.index].rect;
+        SDL_Rect drawnRect = { (int)(d.previous.x + (rect.x - d.previous.x) * alpha),
+                               (int)(d.previous.y + (rect.y - d.previous.y) * alpha), rect.w, rect.h }; // As Render does
+        if (CheckCollision(view, drawnRect)) hash = HashBytes(hash, &drawnRect, sizeof(drawnRect));
+    }
+    for (const TouchButton& btn : buttons) {
+        bool held = btn.pressCount > 0;
+        hash = HashBytes(hash, &held, sizeof(held));
+    }
+    return hash;
+}
+
+// Things that move by design, whatever the signature says. Dynamic obstacles
+// are posed from the step count, so one that could show up in view (an
+// elevator pausing at an end, a crumbled block about to grow back) keeps
+// time running even while it looks still.
+bool SceneAnimating(const World& level, const SDL_Rect& view) {
+#ifdef UPHILL_PROFILE
+    if (profiler.overlay) return true;
+#endif
+    if (particles.count > 0) return true;
+    for (const DynamicObstacle& d : level.dynamics) {
+        if (CheckCollision(view, DynamicObstacleReach(level.obstacles[d.index].type, d.home))) return true;
+    }
+    return false;
+}
+
+bool InputActive(const GameLoop& game) {
+    const InputState& input = game.input;
+    return input.left || input.right || input.jumpHeld || input.jumpPressed || game.pendingInput.count > 0;
+}
+
+// ==========================================
+// MAIN
+// ==========================================
+
+// Time to first frame, from entering main. In the browser, also from the
+// start of navigation, which includes downloading and compiling the wasm.
+void ReportFirstFrame(GameLoop& game) {
+    game.firstFrameMs = (SDL_GetPerformanceCounter() - launchCounter) * 1000.0 / game.counterFreq;
+#ifdef __EMSCRIPTEN__
+    SDL_Log("First frame: %.1f ms after main, %.1f ms after navigation start", game.firstFrameMs, emscripten_get_now());
+#else
+    SDL_Log("First frame: %.1f ms after launch", game.firstFrameMs);
+#endif
+}
+
+// One iteration of the main loop. Native builds call it from a plain while
+// loop; the web build hands it to the browser (requestAnimationFrame) so we
+// never block the JS event loop.
+void RunFrame(void* arg) {
+    GameLoop& game = *(GameLoop*)arg;
+#ifdef UPHILL_COUNT_ALLOCATIONS
+    Uint64 allocationsBefore = threadAllocations;
+#endif
+
+#ifndef __EMSCRIPTEN__
+    // Power saving: the last frame changed nothing, so sleep until an event
+    // arrives (left in the queue for HandleInput). Time asleep isn't
+    // simulated: idle needs no dynamic obstacle that could reach the view
+    // (SceneAnimating), and the ones out of view just resume. In the browser
+    // requestAnimationFrame paces the loop, so skipping the draw is all we do.
+    if (game.idle) {
+        SDL_WaitEventTimeout(nullptr, (int)IDLE_WAKE_MS);
+        game.lastCounter = SDL_GetPerformanceCounter();
+        game.nextFrameTime = game.lastCounter;
+    }
+#endif
+
+    // Frame limiter (no vsync): wait before sampling input so it's as fresh
+    // as possible. Sleep most of the way, then spin for the last millisecond.
+    if (game.frameLimitTicks) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now < game.nextFrameTime) {
+            Uint64 waitMs = (game.nextFrameTime - now) * 1000 / game.counterFreq;
+            if (waitMs > 1) SDL_Delay((Uint32)(waitMs - 1));
+            while (SDL_GetPerformanceCounter() < game.nextFrameTime) {}
+        }
+        now = SDL_GetPerformanceCounter();
+        game.nextFrameTime = (now - game.nextFrameTime < game.frameLimitTicks) ? game.nextFrameTime + game.frameLimitTicks
+                                                                               : now + game.frameLimitTicks;
+    }
+
+    // Integer time keeping: scaling elapsed ticks by PHYSICS_HZ makes one
+    // step exactly counterFreq units, so no rounding error ever accumulates
+    Uint64 currentCounter = SDL_GetPerformanceCounter();
+    float frameSeconds = (float)(currentCounter - game.lastCounter) / game.counterFreq;
+    game.accumulator += (currentCounter - game.lastCounter) * PHYSICS_HZ;
+    game.lastCounter = currentCounter;
+
+    PROFILE_FRAME_BEGIN();
+    PROFILE_BEGIN(PROFILE_INPUT);
+    HandleInput(game);
+    PROFILE_END(PROFILE_INPUT);
+
+    PROFILE_BEGIN(PROFILE_STREAM);
+    if (UpdateChunkStreamer(game.streamer, world, CameraView(game.camera))) game.redraw = true;
+    PROFILE_END(PROFILE_STREAM);
+
+    int steps = 0;
+    const QualityTier& tier = QUALITY_TIERS[game.quality.tier];
+    while (game.accumulator >= game.counterFreq && steps < tier.maxStepsPerFrame) {
+        PROFILE_BEGIN(PROFILE_PHYSICS);
+        if (game.lowLatency) {
+            // This step simulates up to 'stepEnd'; it sees only input from before then
+            Uint64 stepEnd = currentCounter - (game.accumulator - game.counterFreq) / PHYSICS_HZ;
+            ApplyInputEventsUntil(game, stepEnd);
+        }
+        game.previous = game.player;
+        RecordReplayStep(game.recorder, game.input);
+        PoseDynamicObstacles(world, game.recorder.header.steps - 1); // Step index within the replay, as --replay sees it
+        Uint8 events = UpdatePhysics(game.player, game.input, world, TIME_STEP);
+        if (events & PHYSICS_EVENT_JUMP) CountTelemetry(TELEMETRY_JUMPS);
+        if (events & PHYSICS_EVENT_RESPAWN) CountTelemetry(TELEMETRY_DEATHS);
+        if (game.input.jumpPressed) {
+            // Consumed by exactly one step
+            game.input.jumpPressed = false;
+            game.jumpStepTime = game.jumpPressTime;
+            game.jumpPressTime = 0;
+        }
+        PROFILE_END(PROFILE_PHYSICS);
+        if (!game.previous.onGround && game.player.onGround) EmitLandingDust(particles, game.player, ToFloat(game.previous.vel.y));
+        game.accumulator -= game.counterFreq;
+        game.stepCount++;
+        steps++;
+    }
+    // Too far behind (breakpoint, app suspended): drop whole steps we can't catch up on
+    if (game.accumulator >= game.counterFreq) {
+        CountTelemetry(TELEMETRY_DROPPED_STEPS, (Uint32)std::min<Uint64>(game.accumulator / game.counterFreq, 0xFFFFFFFFu));
+        game.accumulator %= game.counterFreq;
+    }
+    CountTelemetry(TELEMETRY_STEPS_PER_FRAME + steps);
+
+    // Draw where the player is between the last two steps, so the motion
+    // stays smooth when the display rate and physics rate don't match
+    float alpha = (float)game.accumulator / (float)game.counterFreq;
+    Player drawn = InterpolatePlayer(game.previous, game.player, alpha);
+
+    UpdateCamera(game.camera, drawn);
+
+    // At rest: no input and the last step left the player exactly as it was
+    bool atRest = !InputActive(game) && HashPlayer(HASH_SEED, game.previous) == HashPlayer(HASH_SEED, game.player);
+    game.restSeconds = atRest ? game.restSeconds + frameSeconds : 0.0f;
+
+    PROFILE_BEGIN(PROFILE_PARTICLES);
+    if (!game.player.onGround && ToFloat(game.player.vel.y) < 0) EmitJumpTrail(particles, drawn); // Only jumps move the player up
+    if (game.restSeconds < IDLE_WEATHER_TIMEOUT) EmitWeather(particles, CameraView(game.camera), frameSeconds);
+    UpdateParticles(particles, frameSeconds);
+    PROFILE_END(PROFILE_PARTICLES);
+
+    // Only skip while at rest: otherwise the present is what paces the loop
+    Uint64 scene = SceneSignature(world, drawn, game.camera, alpha);
+    game.idle = atRest && !game.redraw && !SceneAnimating(world, CameraView(game.camera)) && scene == game.presentedScene;
+    if (game.idle) {
+        game.idleFrames++;
+        CountTelemetry(TELEMETRY_IDLE_FRAMES);
+    } else {
+        PROFILE_BEGIN(PROFILE_RENDER);
+        bool scaled = BeginScene(tier.renderScale);
+        Render(world, drawn, game.camera, alpha);
+        if (scaled) EndScene(tier.renderScale);
+        RenderControls();
+        PROFILE_OVERLAY();
+        PROFILE_END(PROFILE_RENDER);
+
+        Uint64 workEnd = SDL_GetPerformanceCounter();
+        PROFILE_BEGIN(PROFILE_PRESENT);
+        SDL_RenderPresent(renderer);
+        PROFILE_END(PROFILE_PRESENT);
+        float workMs = (float)((workEnd - currentCounter) * 1000.0 / game.counterFreq);
+        UpdateQuality(game.quality, frameSeconds * 1000.0f, workMs);
+        CountTelemetry(TELEMETRY_FRAME_MS + TelemetryTimeBucket(frameSeconds * 1000.0f));
+        CountTelemetry(TELEMETRY_WORK_MS + TelemetryTimeBucket(workMs));
+        game.presentedScene = scene;
+        game.redraw = false;
+        if (game.firstFrameMs == 0) ReportFirstFrame(game);
+    }
+
+    // Jump responsiveness: press to the present of the first frame simulating it
+    if (game.jumpStepTime) {
+        double ms = (SDL_GetPerformanceCounter() - game.jumpStepTime) * 1000.0 / game.counterFreq;
+        game.jumpLatencyCount++;
+        game.jumpLatencySumMs += ms;
+        game.jumpLatencyMaxMs = std::max(game.jumpLatencyMaxMs, ms);
+        game.jumpStepTime = 0;
+    }
+    PROFILE_FRAME_END(steps);
+#ifndef UPHILL_THREADS
+    PollTelemetry(telemetry, SDL_GetPerformanceCounter());
+#endif
+
+    game.frameCount++;
+#ifdef UPHILL_COUNT_ALLOCATIONS
+    Uint64 allocations = threadAllocations - allocationsBefore;
+    if (allocations > 0 && game.frameCount > ALLOCATION_WARMUP_FRAMES && allocationReports < ALLOCATION_REPORT_LIMIT) {
+        allocationReports++;
+        SDL_Log("Frame %llu: %llu heap allocations", (unsigned long long)game.frameCount, (unsigned long long)allocations);
+    }
+#endif
+}
+
+void Shutdown(GameLoop& game) {
+    CloseChunkStreamer(game.streamer);
+    CloseTelemetry(telemetry);
+    if (game.jumpLatencyCount > 0) {
+        SDL_Log("Jump latency%s: %llu presses, avg %.1f ms, max %.1f ms", game.lowLatency ? " (low-latency)" : "",
+                (unsigned long long)game.jumpLatencyCount, game.jumpLatencySumMs / game.jumpLatencyCount, game.jumpLatencyMaxMs);
+    }
+    if (game.replayPath[0] && !SaveReplay(game.recorder, game.replayPath)) {
+        SDL_Log("Couldn't save replay to %s", game.replayPath);
+    }
+    if (game.idleFrames > 0) {
+        SDL_Log("Power saving: %llu of %llu frames not drawn", (unsigned long long)game.idleFrames, (unsigned long long)game.frameCount);
+    }
+    if (game.quality.changes > 0) SDL_Log("Quality: %d tier changes, ended on tier %d", game.quality.changes, game.quality.tier);
+
+    if (sceneTarget) SDL_DestroyTexture(sceneTarget);
+    if (staticLayer) SDL_DestroyTexture(staticLayer);
+    if (tileAtlas) SDL_DestroyTexture(tileAtlas);
+    SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+}
+
+#ifdef __EMSCRIPTEN__
+// The fetched level arrives as one ArrayBuffer copied into 'data'
+void OnLevelFetched(void* arg, void* data, int size) {
+    GameLoop& game = *(GameLoop*)arg;
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!LoadLevelFromMemory(world, (const Uint8*)data, (size_t)size)) {
+        SDL_Log("Fetched level is invalid");
+        return;
+    }
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    SDL_Log("Level %u: %u obstacles parsed in %.2f ms", world.levelId, (unsigned)world.obstacles.size(), ms);
+
+    BakeStaticLayer(world);
+    game.player = SpawnPlayer();
+    game.previous = game.player;
+    game.camera.bounds = world.cameraBounds;
+    game.redraw = true;
+    StartReplayRecording(game.recorder, world.levelId, game.recorder.header.seed);
+}
+
+void OnLevelFetchFailed(void* arg) {
+    (void)arg;
+    SDL_Log("Level fetch failed, staying on the built-in level");
+}
+
+void RunBrowserFrame(void* arg) {
+    RunFrame(arg);
+    GameLoop& game = *(GameLoop*)arg;
+    if (game.deferredLevel && game.firstFrameMs > 0) {
+        emscripten_async_wget_data(game.deferredLevel, &game, OnLevelFetched, OnLevelFetchFailed);
+        game.deferredLevel = nullptr;
+    }
+    if (!isRunning) {
+        emscripten_cancel_main_loop();
+        Shutdown(*(GameLoop*)arg);
+    }
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    launchCounter = SDL_GetPerformanceCounter();
+    LaunchOptions options = ParseLaunchOptions(argc, argv);
+    if (options.exportLevel) {
+        World level;
+        if (options.generate) GenerateClimbLevel(level, options.generate, options.seed);
+        else LoadLevel(level);
+        bool saved = SaveLevelFile(level, options.exportLevel);
+        SDL_Log("export: level %u to %s %s", level.levelId, options.exportLevel, saved ? "ok" : "failed");
+        return saved ? 0 : 1;
+    }
+    if (options.replay) {
+        RunReplay(options);
+        return 0;
+    }
+    if (options.headless) {
+        RunHeadless(options);
+        return 0;
+    }
+    if (options.benchmark) {
+        RunBenchmarks(options);
+        return 0;
+    }
+    if (options.rollbackTest) {
+        RunRollbackTest(options);
+        return 0;
+    }
+    if (options.validate) {
+        return RunValidation(options) ? 0 : 1;
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) return -1;
+
+    window = SDL_CreateWindow("Uphill Proto", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
+    // Low-latency mode presents without vsync; the frame limiter paces it instead.
+    // The web build is always paced by requestAnimationFrame.
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+#ifdef __EMSCRIPTEN__
+    rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+#else
+    if (!options.lowLatency) rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+#endif
+    renderer = SDL_CreateRenderer(window, -1, rendererFlags);
+    
+    // Critical for Android: Scale 1280x720 logic to whatever the phone screen is
+    SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    InitControls();
+    CreateTileAtlas();
+    InitParticlePool(particles, PARTICLE_CAPACITY);
+#ifdef __EMSCRIPTEN__
+    // Start on the built-in level; a --level file arrives as one fetch (see OnLevelFetched)
+    LoadLevel(world);
+#endif
+
+    // Static so it outlives main() on the web, where main returns into the browser loop
+    static GameLoop game;
+#ifndef __EMSCRIPTEN__
+    // Streaming starts from the spawn screen; the camera takes over from the first frame
+    SDL_Rect spawnView = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    if (!(options.stream && options.level && OpenChunkStreamer(game.streamer, world, options.level, spawnView))) {
+        LoadSelectedLevel(world, options);
+    }
+#endif
+    BakeStaticLayer(world);
+
+    game.player = SpawnPlayer();
+    game.previous = game.player;
+
+    game.camera = { 0, 0, world.cameraBounds };
+    UpdateCamera(game.camera, game.player);
+
+    game.counterFreq = SDL_GetPerformanceFrequency();
+    game.lastCounter = SDL_GetPerformanceCounter();
+    game.accumulator = 0;
+    game.stepCount = 0;
+    game.frameCount = 0;
+
+    // Target frame rate: --fps, else the display's refresh rate
+    SDL_DisplayMode mode;
+    int fps = options.fps;
+    if (fps <= 0 && SDL_GetWindowDisplayMode(window, &mode) == 0) fps = mode.refresh_rate;
+    if (fps <= 0) fps = 60;
+    game.quality.budgetMs = 1000.0f / fps;
+    game.quality.adaptive = options.quality < 0;
+    ApplyQualityTier(game.quality, std::max(options.quality, 0));
+    game.redraw = true; // Nothing is on screen yet
+
+    game.lowLatency = options.lowLatency;
+    game.frameLimitTicks = 0;
+#ifndef __EMSCRIPTEN__
+    if (options.lowLatency) {
+        game.frameLimitTicks = game.counterFreq / fps;
+        game.nextFrameTime = game.lastCounter;
+        SDL_Log("Low-latency mode: vsync off, frame limiter at %d fps", fps);
+    }
+#endif
+
+    // Inputs are always recorded; saved to --record or the app's pref dir
+    StartReplayRecording(game.recorder, world.levelId, options.seed);
+    game.replayPath[0] = '\0';
+    if (options.record) {
+        SDL_snprintf(game.replayPath, sizeof(game.replayPath), "%s", options.record);
+    } else if (char* prefPath = SDL_GetPrefPath("uphill", "proto")) {
+        SDL_snprintf(game.replayPath, sizeof(game.replayPath), "%slast_session.uprp", prefPath);
+        SDL_free(prefPath);
+    }
+
+    // Metrics too, next to the replay unless --telemetry says otherwise
+    char telemetryPath[512] = "";
+    if (options.telemetry) {
+        SDL_snprintf(telemetryPath, sizeof(telemetryPath), "%s", options.telemetry);
+    } else if (char* prefPath = SDL_GetPrefPath("uphill", "proto")) {
+        SDL_snprintf(telemetryPath, sizeof(telemetryPath), "%slast_session.uptl", prefPath);
+        SDL_free(prefPath);
+    }
+    OpenTelemetry(telemetry, telemetryPath, world.levelId);
+
+#ifdef __EMSCRIPTEN__
+    // The download waits for the first frame so it doesn't compete with startup (see RunBrowserFrame)
+    game.deferredLevel = options.level;
+
+    // 0 fps = follow requestAnimationFrame; 1 = don't return from main
+    emscripten_set_main_loop_arg(RunBrowserFrame, &game, 0, 1);
+#else
+    while (isRunning) {
+        RunFrame(&game);
+    }
+    Shutdown(game);
+#endif
     return 0;
 }